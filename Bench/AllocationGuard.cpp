@@ -0,0 +1,190 @@
+/*
+    ==============================================================================
+
+    This file is part of the Midronome plugin, a VST3/AU/AAX plugin for Digital
+    Audio Workstations (DAW) whose purpose is to synchronize DAWs with the
+    Midronome (more info on <https://www.midronome.com/>).
+
+    Copyright © 2023 - Simon Lasnier (Midronome ApS)
+
+    The Midronome plugin is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option) any
+    later version.
+
+    The Midronome plugin is distributed in the hope that it will be useful, but
+    WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+    details.
+
+    You should have received a copy of the GNU General Public License along with
+    the Midronome plugin. If not, see <https://www.gnu.org/licenses/>.
+
+    ==============================================================================
+*/
+
+#include "AllocationGuard.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+
+#if defined(_WIN32)
+ #include <malloc.h>
+#endif
+
+// with glibc, malloc & co are replaced too, and forward to glibc's own allocator - except in the MIDRONOME_RTSAN build,
+// as the RealtimeSanitizer intercepts them itself (operator new then goes through its malloc, so it sees those too)
+#if defined(__GLIBC__) && ! MIDRONOME_RTSAN
+ #define MIDRONOME_REPLACE_MALLOC 1
+#else
+ #define MIDRONOME_REPLACE_MALLOC 0
+#endif
+
+#if MIDRONOME_REPLACE_MALLOC
+extern "C" {
+    void* __libc_malloc (size_t);
+    void* __libc_calloc (size_t, size_t);
+    void* __libc_realloc (void*, size_t);
+    void* __libc_memalign (size_t, size_t);
+    void __libc_free (void*);
+}
+#endif
+
+namespace
+{
+    // the counters must not allocate themselves: a plain thread_local int and lock-free atomics
+    thread_local int checkDepth = 0;
+    std::atomic<int64_t> numAllocations { 0 };
+    std::atomic<int64_t> numDeallocations { 0 };
+    std::atomic<size_t> lastAllocationSize { 0 };
+
+    void countAllocation (size_t size) noexcept
+    {
+        if (checkDepth > 0) {
+            numAllocations.fetch_add(1, std::memory_order_relaxed);
+            lastAllocationSize.store(size, std::memory_order_relaxed);
+        }
+    }
+
+    void countDeallocation (void* ptr) noexcept
+    {
+        if (checkDepth > 0 && ptr != nullptr)
+            numDeallocations.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void* allocate (size_t size) noexcept
+    {
+        countAllocation(size);
+       #if MIDRONOME_REPLACE_MALLOC
+        return __libc_malloc(size == 0 ? 1 : size);
+       #else
+        return std::malloc(size == 0 ? 1 : size);
+       #endif
+    }
+
+    void* allocateAligned (size_t size, size_t alignment) noexcept
+    {
+        countAllocation(size);
+       #if MIDRONOME_REPLACE_MALLOC
+        return __libc_memalign(alignment, size == 0 ? 1 : size);
+       #elif defined(_WIN32)
+        return _aligned_malloc(size == 0 ? 1 : size, alignment);
+       #else
+        void* ptr = nullptr;
+        return posix_memalign(&ptr, alignment, size == 0 ? 1 : size) == 0 ? ptr : nullptr;
+       #endif
+    }
+
+    void deallocate (void* ptr) noexcept
+    {
+        countDeallocation(ptr);
+       #if MIDRONOME_REPLACE_MALLOC
+        __libc_free(ptr);
+       #else
+        std::free(ptr);
+       #endif
+    }
+
+    void deallocateAligned (void* ptr) noexcept
+    {
+        countDeallocation(ptr);
+       #if MIDRONOME_REPLACE_MALLOC
+        __libc_free(ptr);
+       #elif defined(_WIN32)
+        _aligned_free(ptr);
+       #else
+        std::free(ptr);
+       #endif
+    }
+
+    void* allocateOrThrow (size_t size)
+    {
+        if (auto* ptr = allocate(size))
+            return ptr;
+        throw std::bad_alloc();
+    }
+
+    void* allocateAlignedOrThrow (size_t size, std::align_val_t alignment)
+    {
+        if (auto* ptr = allocateAligned(size, static_cast<size_t>(alignment)))
+            return ptr;
+        throw std::bad_alloc();
+    }
+}
+
+//==============================================================================
+AllocationGuard::ScopedCheck::ScopedCheck()  { checkDepth++; }
+AllocationGuard::ScopedCheck::~ScopedCheck() { checkDepth--; }
+
+int64_t AllocationGuard::getNumAllocations() noexcept      { return numAllocations.load(); }
+int64_t AllocationGuard::getNumDeallocations() noexcept    { return numDeallocations.load(); }
+size_t AllocationGuard::getLastAllocationSize() noexcept   { return lastAllocationSize.load(); }
+
+
+//==============================================================================
+void* operator new (size_t size)                                                { return allocateOrThrow(size); }
+void* operator new[] (size_t size)                                              { return allocateOrThrow(size); }
+void* operator new (size_t size, const std::nothrow_t&) noexcept                { return allocate(size); }
+void* operator new[] (size_t size, const std::nothrow_t&) noexcept              { return allocate(size); }
+void* operator new (size_t size, std::align_val_t alignment)                    { return allocateAlignedOrThrow(size, alignment); }
+void* operator new[] (size_t size, std::align_val_t alignment)                  { return allocateAlignedOrThrow(size, alignment); }
+void* operator new (size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept   { return allocateAligned(size, static_cast<size_t>(alignment)); }
+void* operator new[] (size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return allocateAligned(size, static_cast<size_t>(alignment)); }
+
+void operator delete (void* ptr) noexcept                                       { deallocate(ptr); }
+void operator delete[] (void* ptr) noexcept                                     { deallocate(ptr); }
+void operator delete (void* ptr, size_t) noexcept                               { deallocate(ptr); }
+void operator delete[] (void* ptr, size_t) noexcept                             { deallocate(ptr); }
+void operator delete (void* ptr, const std::nothrow_t&) noexcept                { deallocate(ptr); }
+void operator delete[] (void* ptr, const std::nothrow_t&) noexcept              { deallocate(ptr); }
+void operator delete (void* ptr, std::align_val_t) noexcept                     { deallocateAligned(ptr); }
+void operator delete[] (void* ptr, std::align_val_t) noexcept                   { deallocateAligned(ptr); }
+void operator delete (void* ptr, size_t, std::align_val_t) noexcept             { deallocateAligned(ptr); }
+void operator delete[] (void* ptr, size_t, std::align_val_t) noexcept           { deallocateAligned(ptr); }
+void operator delete (void* ptr, std::align_val_t, const std::nothrow_t&) noexcept   { deallocateAligned(ptr); }
+void operator delete[] (void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { deallocateAligned(ptr); }
+
+
+//==============================================================================
+#if MIDRONOME_REPLACE_MALLOC
+extern "C" {
+    void* malloc (size_t size) noexcept                 { countAllocation(size); return __libc_malloc(size); }
+    void* calloc (size_t num, size_t size) noexcept     { countAllocation(num * size); return __libc_calloc(num, size); }
+    void* realloc (void* ptr, size_t size) noexcept     { countAllocation(size); return __libc_realloc(ptr, size); }
+    void free (void* ptr) noexcept                      { countDeallocation(ptr); __libc_free(ptr); }
+
+    void* memalign (size_t alignment, size_t size) noexcept         { countAllocation(size); return __libc_memalign(alignment, size); }
+    void* aligned_alloc (size_t alignment, size_t size) noexcept    { countAllocation(size); return __libc_memalign(alignment, size); }
+
+    int posix_memalign (void** ptr, size_t alignment, size_t size) noexcept
+    {
+        if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0)
+            return EINVAL;
+        countAllocation(size);
+        *ptr = __libc_memalign(alignment, size);
+        return *ptr != nullptr ? 0 : ENOMEM;
+    }
+}
+#endif
@@ -0,0 +1,56 @@
+/*
+    ==============================================================================
+
+    This file is part of the Midronome plugin, a VST3/AU/AAX plugin for Digital
+    Audio Workstations (DAW) whose purpose is to synchronize DAWs with the
+    Midronome (more info on <https://www.midronome.com/>).
+
+    Copyright © 2023 - Simon Lasnier (Midronome ApS)
+
+    The Midronome plugin is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option) any
+    later version.
+
+    The Midronome plugin is distributed in the hope that it will be useful, but
+    WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+    details.
+
+    You should have received a copy of the GNU General Public License along with
+    the Midronome plugin. If not, see <https://www.gnu.org/licenses/>.
+
+    ==============================================================================
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+//==============================================================================
+/**
+    Counts the heap allocations and deallocations made by the current thread
+    while a ScopedCheck exists, to check that processBlock never touches the
+    heap (the allocator can lock, or ask the OS for memory, which the audio
+    thread must never wait for).
+
+    AllocationGuard.cpp replaces the global operator new/delete of the bench,
+    and with glibc also malloc/calloc/realloc/free and the aligned variants,
+    so the C allocations made by JUCE or the standard library are seen too
+    (in the MIDRONOME_RTSAN build the sanitizer intercepts those itself).
+*/
+struct AllocationGuard
+{
+    struct ScopedCheck {
+        ScopedCheck();
+        ~ScopedCheck();
+    };
+
+    // since the start of the program, only counting the calls made inside a ScopedCheck
+    static int64_t getNumAllocations() noexcept;
+    static int64_t getNumDeallocations() noexcept;
+
+    // size of the last allocation counted (0 for a deallocation), to help finding it
+    static size_t getLastAllocationSize() noexcept;
+};
@@ -0,0 +1,238 @@
+/*
+    ==============================================================================
+
+    This file is part of the Midronome plugin, a VST3/AU/AAX plugin for Digital
+    Audio Workstations (DAW) whose purpose is to synchronize DAWs with the
+    Midronome (more info on <https://www.midronome.com/>).
+
+    Copyright © 2023 - Simon Lasnier (Midronome ApS)
+
+    The Midronome plugin is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option) any
+    later version.
+
+    The Midronome plugin is distributed in the hope that it will be useful, but
+    WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+    details.
+
+    You should have received a copy of the GNU General Public License along with
+    the Midronome plugin. If not, see <https://www.gnu.org/licenses/>.
+
+    ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <cmath>
+#include <iterator>
+#include <limits>
+#include <random>
+
+//==============================================================================
+/**
+    A random host, standing in for the host's juce::AudioPlayHead in the fuzzer
+    of the bench: everything a host reports is drawn from a seeded generator,
+    so a failing run is replayed exactly from its seed.
+
+    Most of the time it behaves like a host playing normally (the position
+    moves on by the tempo, the loop wraps), but between blocks it can start or
+    stop, relocate (before 0, or very far), change the tempo in and out of the
+    sync range (and to 0, negative or non-finite values), change the time
+    signature (x/8, and values no host should send like 0 or 3/16), change or
+    reverse the loop, jump timeInSamples, report a last bar start which does
+    not match the position, leave out any optional field, or give no position
+    at all. Call advance() after each processBlock().
+*/
+class FuzzedPlayHead : public juce::AudioPlayHead
+{
+public:
+    FuzzedPlayHead (uint32_t seed, double sr) : random (seed), sampleRate (sr) {}
+
+    //==============================================================================
+    juce::Optional<PositionInfo> getPosition() const override
+    {
+        if (!hasPosition)
+            return {};
+
+        PositionInfo info;
+        info.setIsPlaying(isPlaying);
+        info.setIsLooping(isLooping);
+
+        if (fields[bpmField])
+            info.setBpm(bpm);
+        if (fields[timeSignatureField])
+            info.setTimeSignature(TimeSignature { numerator, denominator });
+        if (fields[timeInSamplesField])
+            info.setTimeInSamples(timeInSamples);
+        if (fields[timeInSecondsField])
+            info.setTimeInSeconds(timeInSeconds);
+        if (fields[ppqPositionField])
+            info.setPpqPosition(ppqPos);
+        if (fields[lastBarStartField])
+            info.setPpqPositionOfLastBarStart(lastBarStart);
+        if (fields[loopPointsField])
+            info.setLoopPoints(LoopPoints { loopStart, loopEnd });
+
+        return info;
+    }
+
+    // moves the transport on by the block just processed, and draws what the host does before the next one
+    void advance (int numSamples)
+    {
+        if (isPlaying) {
+            auto dppq = std::isfinite(bpm) && bpm > 0.0 ? bpm / (60.0 * sampleRate) : 0.0;
+            ppqPos += dppq * numSamples;
+            timeInSamples += numSamples;
+            timeInSeconds = static_cast<double>(timeInSamples) / sampleRate;
+
+            if (isLooping && loopEnd > loopStart && ppqPos >= loopEnd && ppqPos - dppq * numSamples < loopEnd) {
+                ppqPos = loopStart + (ppqPos - loopEnd);
+                if (chance(0.7)) // the time jumps back in most hosts
+                    timeInSamples = static_cast<int64_t>(loopStart * 60.0 * sampleRate / bpm);
+            }
+        }
+
+        updateLastBarStart();
+
+        // how often the host does each of these, in times per second
+        auto happens = [this, numSamples] (double perSecond) { return chance(perSecond * numSamples / sampleRate); };
+
+        if (happens(0.2))
+            isPlaying = !isPlaying;
+        if (happens(0.2))
+            relocate();
+        if (happens(2.0))
+            bpm = std::isfinite(bpm) && bpm > 0.0 ? bpm * uniform(0.97, 1.03) : 120.0; // tempo ramps
+        if (happens(0.1))
+            bpm = pickTempo();
+        if (happens(0.1))
+            pickTimeSignature();
+        if (happens(0.1))
+            pickLoop();
+        if (happens(0.05))
+            timeInSamples += static_cast<int64_t>(uniform(-1.0e6, 1.0e6)); // a host time which is not continuous
+        if (happens(0.2))
+            lastBarStart = chance(0.5) ? ppqPos + uniform(-8.0, 8.0) : pickExtremeValue(); // not the bar of the position
+        if (happens(0.1))
+            pickFields();
+        if (happens(0.05))
+            timeInSeconds = pickExtremeValue();
+
+        hasPosition = !happens(0.05);
+    }
+
+    // the host would run the sync: playing at a tempo within the sync range with a position after the pre-roll
+    bool isSyncExpected (double minBpm, double maxBpm) const
+    {
+        return hasPosition && isPlaying && fields[bpmField] && fields[ppqPositionField]
+            && bpm >= minBpm && bpm <= maxBpm && ppqPos >= 0.0 && ppqPos < 1.0e6;
+    }
+
+    // the block sizes given to processBlock: mostly the one announced in prepareToPlay, but not always
+    int nextBlockSize (int preparedBlockSize)
+    {
+        if (chance(0.8))
+            return preparedBlockSize;
+        if (chance(0.1))
+            return chance(0.5) ? 0 : 1;
+        if (chance(0.2))
+            return static_cast<int>(uniform(1.0, 2.0 * preparedBlockSize)); // more than announced, like some hosts do
+        return static_cast<int>(uniform(1.0, preparedBlockSize));
+    }
+
+    bool chance (double probability) { return std::uniform_real_distribution<double> (0.0, 1.0) (random) < probability; }
+    double uniform (double from, double to) { return std::uniform_real_distribution<double> (from, to) (random); }
+
+private:
+    //==============================================================================
+    enum Field { bpmField, timeSignatureField, timeInSamplesField, timeInSecondsField, ppqPositionField, lastBarStartField, loopPointsField, numFields };
+
+    double pickExtremeValue()
+    {
+        const double values[] = { 0.0, -1.0, 1.0e9, -1.0e9, 1.0e300, std::numeric_limits<double>::infinity(),
+                                  -std::numeric_limits<double>::infinity(), std::numeric_limits<double>::quiet_NaN() };
+        return values[std::uniform_int_distribution<size_t> (0, std::size(values) - 1) (random)];
+    }
+
+    double pickTempo()
+    {
+        const double edges[] = { 0.0, -120.0, 29.9, 30.0, 400.0, 400.1, 1000.0, 1.0e6 };
+        if (chance(0.6))
+            return uniform(20.0, 420.0);
+        if (chance(0.8))
+            return edges[std::uniform_int_distribution<size_t> (0, std::size(edges) - 1) (random)];
+        return pickExtremeValue();
+    }
+
+    void pickTimeSignature()
+    {
+        const int signatures[][2] = { { 4, 4 }, { 3, 4 }, { 7, 8 }, { 6, 8 }, { 5, 8 }, { 12, 8 }, { 2, 2 }, { 1, 1 }, { 15, 4 },
+                                      { 3, 16 }, { 1, 8 }, { 200, 4 }, { 99, 1 }, { 0, 4 }, { 4, 0 }, { -3, 4 }, { 4, -4 } };
+        auto i = std::uniform_int_distribution<size_t> (0, std::size(signatures) - 1) (random);
+        numerator = signatures[i][0];
+        denominator = signatures[i][1];
+    }
+
+    void pickLoop()
+    {
+        isLooping = chance(0.7);
+        loopStart = chance(0.8) ? std::floor(uniform(-4.0, 64.0)) : uniform(-4.0, 64.0);
+        loopEnd = chance(0.8) ? loopStart + std::floor(uniform(1.0, 16.0)) : uniform(-4.0, 64.0); // can be empty or reversed
+        if (chance(0.05))
+            loopEnd = pickExtremeValue();
+    }
+
+    void relocate()
+    {
+        if (chance(0.7))
+            ppqPos = std::floor(uniform(0.0, 1000.0)) * (chance(0.5) ? 1.0 : 0.25);
+        else if (chance(0.5))
+            ppqPos = uniform(-8.0, 0.0); // pre-roll
+        else if (chance(0.8))
+            ppqPos = uniform(0.0, 1.0e7);
+        else
+            ppqPos = pickExtremeValue();
+
+        timeInSamples = std::isfinite(ppqPos) && std::abs(ppqPos) < 1.0e9 && std::isfinite(bpm) && bpm > 0.0
+                      ? static_cast<int64_t>(ppqPos * 60.0 * sampleRate / bpm) : 0;
+        timeInSeconds = static_cast<double>(timeInSamples) / sampleRate;
+        updateLastBarStart();
+
+        if (!std::isfinite(ppqPos)) // so the host does not stay lost for the rest of the run
+            ppqPos = 0.0;
+    }
+
+    void pickFields()
+    {
+        for (auto& field : fields)
+            field = !chance(0.15);
+    }
+
+    void updateLastBarStart()
+    {
+        auto barLength = numerator > 0 && denominator > 0 ? 4.0 * numerator / denominator : 4.0;
+        lastBarStart = std::floor(ppqPos / barLength) * barLength;
+    }
+
+    //==============================================================================
+    std::mt19937 random;
+    double sampleRate;
+
+    bool hasPosition = true;
+    bool fields[numFields] = { true, true, true, true, true, true, true };
+
+    bool isPlaying = false;
+    double ppqPos = 0.0;
+    double lastBarStart = 0.0;
+    double bpm = 120.0;
+    int64_t timeInSamples = 0;
+    double timeInSeconds = 0.0;
+    int numerator = 4, denominator = 4;
+
+    bool isLooping = false;
+    double loopStart = 0.0, loopEnd = 0.0;
+};
@@ -0,0 +1,224 @@
+/*
+    ==============================================================================
+
+    This file is part of the Midronome plugin, a VST3/AU/AAX plugin for Digital
+    Audio Workstations (DAW) whose purpose is to synchronize DAWs with the
+    Midronome (more info on <https://www.midronome.com/>).
+
+    Copyright © 2023 - Simon Lasnier (Midronome ApS)
+
+    The Midronome plugin is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option) any
+    later version.
+
+    The Midronome plugin is distributed in the hope that it will be useful, but
+    WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+    details.
+
+    You should have received a copy of the GNU General Public License along with
+    the Midronome plugin. If not, see <https://www.gnu.org/licenses/>.
+
+    ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <cmath>
+#include <vector>
+
+//==============================================================================
+/**
+    The tick pulse engine of the plugin before the block-based renderer, kept
+    as the reference of the benchmark: for every sample it advances the ppq
+    position, decides whether a tick starts there, and gets the pulse sample
+    from getCurrentTickPulseSample(), then copies the result to each channel.
+
+    It is the original code, except for the index of the pulse which was a
+    static variable of getCurrentTickPulseSample() (shared by every instance)
+    and is a member here, and the MIDI sent to the Midronome which is left out.
+*/
+class LegacyTickPulseRenderer
+{
+public:
+    void prepare (double sr, int samplesPerBlock)
+    {
+        sampleRate = sr;
+        outputData.assign(static_cast<size_t>(samplesPerBlock), 0.0f);
+
+        hasSyncStarted = false;
+        currentlySendingTickPulse = false;
+        pulseIndex = 0;
+
+        tickPulseLength = 24; // 0.5ms at 48kHz, a bit more at 44.1kHz
+        if (sampleRate > 50000.0) // 88.2 and 96 kHz
+            tickPulseLength *= 2;
+        if (sampleRate > 100000.0) // 176.4 and 192 kHz
+            tickPulseLength *= 2;
+
+        // set to tempo limits to 29.9bpm -> 400.2bpm - ticks will always be sent according to these
+        minSamplesNumBetweenTicks = static_cast<int64_t>(sampleRate / ( (400.2*24.0)/60.0 ));
+        maxSamplesNumBetweenTicks = static_cast<int64_t>(sampleRate / ( (29.9*24.0)/60.0 ));
+    }
+
+    template <typename SampleType>
+    void process (juce::AudioBuffer<SampleType>& buffer, juce::AudioPlayHead& playHead)
+    {
+        auto totalNumSamples = buffer.getNumSamples();
+
+        auto info = playHead.getPosition();
+        auto timeSig = info->getTimeSignature();
+        auto isPlaying = info->getIsPlaying();
+
+        int beatsPerBar = 4; // 4/4 time sig per default
+        auto bpm = info->getBpm().orFallback(0.0);
+
+        bool timeSigIn8 = false;
+
+        // clear buffers
+        buffer.clear();
+        for (auto i = 0; i < totalNumSamples; i++)
+            outputData[static_cast<size_t>(i)] = 0;
+
+        if (timeSig.hasValue()) {
+            beatsPerBar = (4 * timeSig->numerator) / (timeSig->denominator);
+            if (timeSig->denominator == 8)
+                timeSigIn8 = true;
+        }
+
+        if (isPlaying && bpm >= 30.0 && bpm <= 400.0)
+        {
+            auto dppqPerSample = bpm / (60.0*sampleRate);
+            auto currentPpqPos = info->getPpqPosition().orFallback(0.0);
+
+            // checking playing continuity (if playhead moved manually or we looped f.x.)
+            auto curTimeInSamples = info->getTimeInSamples();
+            if (!curTimeInSamples.hasValue() || std::abs(curTimeInSamples.orFallback(0) - expectedTimeInSamples) > 2)
+                lastTickNo = -1; // if the playhead has been moved by more than 2 samples, we make lastTickNo invalid
+
+            expectedTimeInSamples = curTimeInSamples.orFallback(0) + totalNumSamples; // for next block check
+
+            for (auto i = 0; i < totalNumSamples; i++)
+            {
+                if (currentPpqPos >= 0.0) {
+                    double errorRange = 20.0*dppqPerSample; // 20 samples error range because of rounding and samples not "landing" exactly on a tick
+
+                    // we start the sync when we are almost 0 modulo beatsPerBar quarternotes, i.e. start of a bar
+                    if (!hasSyncStarted) {
+                        auto ppqPosFromLastBar = currentPpqPos - info->getPpqPositionOfLastBarStart().orFallback(0.0);
+
+                        if (fmod(ppqPosFromLastBar, static_cast<double>(beatsPerBar)) < errorRange) {
+                            hasSyncStarted = true;
+                            samplesSinceLastTick = static_cast<int64_t>(sampleRate);
+                            lastTickNo = -1;
+                        }
+                    }
+
+                    if (hasSyncStarted && !currentlySendingTickPulse) {
+                        bool sendTick = false;
+                        auto tickPos = currentPpqPos*24.0;
+                        auto currentTickNo = static_cast<int64_t>(tickPos);
+                        auto tickRest = tickPos - floor(tickPos); // decimals of the current tick position
+                        bool extraTickInTimeSig8 = false;
+
+                        if (lastTickNo >= 0) {
+                            if (currentTickNo > lastTickNo) {
+                                sendTick = true;
+                            }
+                            else if (timeSigIn8 && (currentTickNo == lastTickNo)) { // in time signatures in x/8 we send twice as many ticks
+                                tickRest -= 0.5;
+                                if (tickRest >= 0 && tickRest < errorRange*24.0) {
+                                    sendTick = true;
+                                    extraTickInTimeSig8 = true;
+                                }
+                            }
+                        }
+                        else {
+                            if (tickRest < errorRange*24.0)
+                                sendTick = true;
+                        }
+
+                        // we do not send a tick if it will give a tempo > 400bpm, and we make sure to send one to avoid tempo < 30bpm
+                        if ( (sendTick && samplesSinceLastTick >= minSamplesNumBetweenTicks) || samplesSinceLastTick >= maxSamplesNumBetweenTicks) {
+                            if (lastTickNo < 0)
+                                lastTickNo = currentTickNo;
+                            else if (!extraTickInTimeSig8)
+                                lastTickNo++;
+                            samplesSinceLastTick = 0;
+                            currentlySendingTickPulse = true;
+                        }
+                    }
+                }
+
+                outputData[static_cast<size_t>(i)] = getCurrentTickPulseSample(); // updates currentlySendingTickPulse accordingly
+
+                currentPpqPos += dppqPerSample;
+                samplesSinceLastTick++;
+            }
+        }
+        else
+        {
+            hasSyncStarted = false;
+
+            // Finish sending pulse if needed
+            if (currentlySendingTickPulse) {
+                for (auto i = 0; i < totalNumSamples; i++)
+                    outputData[static_cast<size_t>(i)] = getCurrentTickPulseSample();
+            }
+        }
+
+        for (auto ch = 0 ; ch < buffer.getNumChannels() ; ch++) {
+            auto* data = buffer.getWritePointer(ch);
+
+            for (auto i = 0 ; i < totalNumSamples ; i++)
+                data[i] = static_cast<SampleType>(outputData[static_cast<size_t>(i)]);
+        }
+    }
+
+    // the array the output is rendered in before being copied to the channels (for --memory-traffic)
+    std::vector<float>& getOutputData() { return outputData; }
+
+private:
+    static constexpr float tickHeight = 0.9f;
+
+    float getCurrentTickPulseSample()
+    {
+        if (!currentlySendingTickPulse)
+            return 0.0f;
+
+        pulseIndex++;
+
+        if (pulseIndex < 4)
+            return ((static_cast<float>(pulseIndex)*tickHeight)/4.0f);
+
+        int samplesBeforeEnd = tickPulseLength - pulseIndex;
+
+        if (samplesBeforeEnd <= 0) {
+            currentlySendingTickPulse = false;
+            pulseIndex = 0;
+            return 0.0f;
+        }
+
+        if (samplesBeforeEnd < 15)
+            return ((static_cast<float>(samplesBeforeEnd)*tickHeight)/15.0f);
+
+        return tickHeight;
+    }
+
+    double sampleRate = 44100.0;
+    std::vector<float> outputData;
+
+    bool hasSyncStarted = false;
+    bool currentlySendingTickPulse = false;
+    int pulseIndex = 0;
+    int tickPulseLength = 24;
+
+    int64_t expectedTimeInSamples = 0;
+    int64_t lastTickNo = -1;
+    int64_t samplesSinceLastTick = 0;
+    int64_t minSamplesNumBetweenTicks = 0;
+    int64_t maxSamplesNumBetweenTicks = 0;
+};
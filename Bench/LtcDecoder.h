@@ -0,0 +1,160 @@
+/*
+    ==============================================================================
+
+    This file is part of the Midronome plugin, a VST3/AU/AAX plugin for Digital
+    Audio Workstations (DAW) whose purpose is to synchronize DAWs with the
+    Midronome (more info on <https://www.midronome.com/>).
+
+    Copyright © 2023 - Simon Lasnier (Midronome ApS)
+
+    The Midronome plugin is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option) any
+    later version.
+
+    The Midronome plugin is distributed in the hope that it will be useful, but
+    WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+    details.
+
+    You should have received a copy of the GNU General Public License along with
+    the Midronome plugin. If not, see <https://www.gnu.org/licenses/>.
+
+    ==============================================================================
+*/
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+//==============================================================================
+/**
+    Decodes the LTC frames of the plugin's "Timecode" output, like a tape machine
+    would: it only looks at the zero crossings (at sub-sample precision), tells
+    half bits from whole bits by their length, and waits for the sync word to
+    read a frame. It is written from the SMPTE 12M layout, independently from
+    LtcEncoder, to check it.
+*/
+class LtcDecoder
+{
+public:
+    struct Frame {
+        int hours, minutes, seconds, frames;
+        bool isDropFrame;
+        double endSample; // the edge ending the frame (start of the next one), in session samples
+    };
+
+    // the nominal bit length is only used to tell half bits from whole bits
+    LtcDecoder (double sampleRate, double framesPerSecond) : samplesPerBit (sampleRate / (80.0 * framesPerSecond)) {}
+
+    void process (const float* data, int numSamples)
+    {
+        for (auto i = 0; i < numSamples; i++) {
+            auto sample = data[i];
+            auto isPositive = sample > 0.0f ? 1 : (sample < 0.0f ? -1 : 0);
+
+            if (isPositive != 0 && sign != 0 && isPositive != sign) {
+                auto crossing = static_cast<double>(position + i - 1) + previous / (previous - sample);
+                onEdge(crossing);
+            }
+
+            if (isPositive != 0) {
+                sign = isPositive;
+                numZeros = 0;
+            }
+            else if (++numZeros > samplesPerBit) { // silence: the transport stopped (a single 0 is an edge in the middle of a sample)
+                reset();
+            }
+            previous = sample;
+        }
+
+        position += numSamples;
+    }
+
+    const std::vector<Frame>& getFrames() const { return frames; }
+
+    // the frame number from 00:00:00:00 (without the frames skipped in drop frame)
+    static int64_t getFrameNo (const Frame& f, int framesPerSecond)
+    {
+        auto totalMinutes = static_cast<int64_t>(f.hours) * 60 + f.minutes;
+        auto frameNo = (totalMinutes * 60 + f.seconds) * framesPerSecond + f.frames;
+        if (f.isDropFrame)
+            frameNo -= 2 * (totalMinutes - totalMinutes / 10);
+        return frameNo;
+    }
+
+private:
+    void reset()
+    {
+        sign = 0;
+        hasHalfBit = false;
+        numBits = 0;
+    }
+
+    void onEdge (double crossing)
+    {
+        auto length = crossing - lastEdge;
+        lastEdge = crossing;
+
+        if (length > 1.5 * samplesPerBit) { // first edge, or a gap
+            hasHalfBit = false;
+            numBits = 0;
+            return;
+        }
+
+        if (length < 0.75 * samplesPerBit) {
+            if (!hasHalfBit) {
+                hasHalfBit = true;
+                return;
+            }
+            hasHalfBit = false;
+            addBit(1, crossing);
+        }
+        else {
+            hasHalfBit = false;
+            addBit(0, crossing);
+        }
+    }
+
+    void addBit (int bit, double endOfBit)
+    {
+        for (auto i = 0; i < 79; i++)
+            bits[i] = bits[i + 1];
+        bits[79] = bit;
+        numBits++;
+
+        // sync word, bits 64 to 79
+        static const int syncWord[16] = { 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 1 };
+        if (numBits < 80)
+            return;
+        for (auto i = 0; i < 16; i++)
+            if (bits[64 + i] != syncWord[i])
+                return;
+
+        auto value = [this] (int firstBit, int numValueBits) {
+            auto v = 0;
+            for (auto i = 0; i < numValueBits; i++)
+                v |= bits[firstBit + i] << i;
+            return v;
+        };
+
+        frames.push_back({ value(48, 4) + 10 * value(56, 2), value(32, 4) + 10 * value(40, 3),
+                           value(16, 4) + 10 * value(24, 3), value(0, 4) + 10 * value(8, 2),
+                           value(10, 1) != 0, endOfBit });
+    }
+
+    double samplesPerBit;
+    std::vector<Frame> frames;
+
+    int bits[80] = {};
+    int numBits = 0;
+    bool hasHalfBit = false;
+
+    int64_t position = 0;
+    float previous = 0.0f;
+    int sign = 0;
+    int numZeros = 0;
+    double lastEdge = -1.0e9;
+};
@@ -0,0 +1,1429 @@
+/*
+    ==============================================================================
+
+    This file is part of the Midronome plugin, a VST3/AU/AAX plugin for Digital
+    Audio Workstations (DAW) whose purpose is to synchronize DAWs with the
+    Midronome (more info on <https://www.midronome.com/>).
+
+    Copyright © 2023 - Simon Lasnier (Midronome ApS)
+
+    The Midronome plugin is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option) any
+    later version.
+
+    The Midronome plugin is distributed in the hope that it will be useful, but
+    WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+    details.
+
+    You should have received a copy of the GNU General Public License along with
+    the Midronome plugin. If not, see <https://www.gnu.org/licenses/>.
+
+    ==============================================================================
+*/
+
+/*
+    midronome-bench: drives MidronomeAudioProcessor::processBlock offline with a
+    simulated playhead, for several sample rates and block sizes, in single and
+    double precision, and reports the time spent per sample, per block and the
+    worst block, next to the time per sample of the per-sample renderer the
+    plugin had before (Bench/LegacyRenderer.h) on the same transport. The runs
+    where the processor costs more per sample than the legacy renderer are marked
+    "slower", and it ends with a warning listing their block sizes (and sets
+    slowerThanLegacy in the JSON written with --json): it is faster from 16 samples
+    blocks on, but with 1 sample blocks its fixed cost per block is still above the
+    legacy renderer's cost per sample.
+
+    With --sync, it runs instead the scripted transport scenarios (loops on and off
+    the grid, pre-roll, tempo ramps, time signature changes, stop/start, jittery or
+    missing playhead fields, see TransportScenarios.h) and reports the mean, p99 and
+    max timing error of the emitted pulses against the ideal 24ppq grid, the p99
+    jitter around the mean error, and the dropped/duplicate ticks.
+    --sub-sample enables the sub-sample pulse placement of the processor, and
+    --lookahead its latency compensation by lookahead (the pulses are then
+    expected that many milliseconds before the grid). It fails if a scenario drops
+    or duplicates a tick, except for the duplicates of the lookahead's catch-up
+    after a start, and the ones listed in lookaheadExemptions (the ticks sent in
+    the lookahead before a stop, which the host only reaches after the start,
+    and the extra ticks of 7/8 sent in the lookahead before the host gives a
+    time signature change).
+
+    With --ltc, it decodes the LTC of the "Timecode" output (LtcDecoder.h) for each
+    frame rate, sample rate and block size, through a long play and a relocation,
+    and checks every frame against the host time (labels and edge timing): it
+    fails if a frame is wrong or dropped, if an edge is more than 1 sample off, or
+    if more than a second of frames is missing.
+
+    With --midi-clock, the processor follows a MIDI clock sent to its input (with
+    jitter, tempo changes, with or without clock before Start, and in 7/8, where a
+    tick is expected between each 2 clocks), and it reports the lock-in time of its
+    PLL, the delay of the first pulse after Start and the timing error of the
+    regenerated pulses against the ideal grid of the clock: it fails if a tick is dropped or sent
+    twice (besides the catch-up after Start), or if the first pulse after Start
+    comes later than the block of the 2nd clock after it, when the tempo is known.
+
+    With --alloc-guard, it runs the transport scenarios with every output enabled
+    and blocks bigger than announced in prepareToPlay, and fails if processBlock
+    allocates or frees memory (AllocationGuard.cpp replaces operator new/delete,
+    and malloc & co with glibc).
+
+    With --memory-traffic, it measures the bytes written per block in the main
+    output (and in the legacy renderer's staging array) with 1, 2 and 8 channels,
+    by counting the samples which no longer hold the value set before the block (a
+    sample written twice counts once), next to the bytes of the pulses alone.
+
+    With --soak, it plays 24 hours (or the given number of hours) without stopping,
+    at tempos which are not round numbers of samples per tick and with a host not
+    giving the time in samples, and fails if a tick is dropped or duplicated, or if
+    the mean error of the last hour drifted from the first hour's: the processor
+    keeps the tick count as an integer and computes the positions from the host's
+    position of each block, so nothing accumulates rounding errors.
+
+    With --fuzz, it runs random hosts (200 runs, or the given number, from seed 1 or
+    the one given with --seed): random sample rates, block sizes (0, or bigger than
+    announced), settings, MIDI input, and transports which do anything a host could
+    report, including missing fields, no position at all and invalid values (NaN,
+    infinite or huge positions, 0bpm, 0/4 or 3/16, see FuzzedPlayHead.h). It fails a
+    run if the processor writes outside of the buffer or out of range in it, sends
+    an invalid MIDI message or one outside of the block, a BPM or beats per bar the
+    host never reported, or ticks closer than a tick at the maximum tempo, or
+    further apart than a tick at the minimum tempo while the host runs the sync.
+    Each run prints its seed, which --fuzz 1 --seed <seed> replays. Built with
+    -DMIDRONOME_UBSAN=ON, undefined behaviour aborts it too.
+
+    With --multi-instance, it runs 8 instances (or the given number) at once for 10
+    seconds (or --seconds), each on its own std::thread like on the parallel audio threads of a host, with every
+    output enabled and different settings and transports, and fails if the output
+    of an instance (every sample of every channel, and the MIDI events) is not bit
+    for bit the one of the same settings run alone on the main thread.
+
+    With --dump-trace, it prints a telemetry trace file as CSV (traces are recorded
+    in MIDRONOME_TRACE_DIR if this environment variable is set, see TelemetryRecorder.h).
+
+    Usage: midronome-bench [--sync] [--sub-sample] [--lookahead <ms>] [--seconds <audio seconds per run>] [--json <file>|-]
+           midronome-bench --ltc
+           midronome-bench --midi-clock
+           midronome-bench --alloc-guard
+           midronome-bench --memory-traffic [--seconds <audio seconds per run>]
+           midronome-bench --soak [<hours>]
+           midronome-bench --fuzz [<runs>] [--seed <first seed>]
+           midronome-bench --multi-instance [<instances>] [--seconds <audio seconds per instance>]
+           midronome-bench --dump-trace <file>
+*/
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "AllocationGuard.h"
+#include "FuzzedPlayHead.h"
+#include "LegacyRenderer.h"
+#include "LtcDecoder.h"
+#include "SimulatedPlayHead.h"
+#include "SyncAnalysis.h"
+#include "TransportScenarios.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+//==============================================================================
+struct BenchResult {
+    const char* precision;
+    double sampleRate;
+    int blockSize;
+    int64_t numBlocks;
+    double nsPerSample;
+    double nsPerBlock;
+    double worstNsPerBlock;
+    double legacyNsPerSample; // the per-sample renderer of Bench/LegacyRenderer.h, on the same transport
+    
+    bool isSlowerThanLegacy() const { return nsPerSample > legacyNsPerSample; }
+};
+
+struct BlockTimes {
+    double totalNs;
+    double worstNs;
+};
+
+// times numBlocks blocks, advancing the playhead after each one, after warming up (caches, first tick, sync start)
+template <typename ProcessFunction>
+static BlockTimes timeBlocks (SimulatedPlayHead& playHead, int blockSize, int64_t numBlocks, ProcessFunction&& process)
+{
+    using Clock = std::chrono::steady_clock;
+
+    for (auto i = 0; i < 64; i++) {
+        process();
+        playHead.advance(blockSize);
+    }
+
+    BlockTimes times { 0.0, 0.0 };
+
+    for (int64_t i = 0; i < numBlocks; i++) {
+        auto start = Clock::now();
+        process();
+        auto blockNs = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+
+        times.totalNs += blockNs;
+        times.worstNs = std::max(times.worstNs, blockNs);
+        playHead.advance(blockSize);
+    }
+
+    return times;
+}
+
+template <typename SampleType>
+static BenchResult runBench (double sampleRate, int blockSize, double seconds, bool subSampleTicks)
+{
+    auto numBlocks = std::max<int64_t>(1, static_cast<int64_t>(seconds * sampleRate) / blockSize);
+
+    MidronomeAudioProcessor processor;
+    processor.setSubSampleTicks(subSampleTicks);
+    SimulatedPlayHead playHead (sampleRate);
+    playHead.setTempoAt(0, 120.0);
+    playHead.playAt(0);
+    processor.setPlayHead(&playHead);
+    processor.prepareToPlay(sampleRate, blockSize);
+
+    juce::AudioBuffer<SampleType> buffer (processor.getTotalNumOutputChannels(), blockSize);
+    juce::MidiBuffer midiMessages;
+    midiMessages.ensureSize(2048); // like the plugin wrappers do
+
+    auto times = timeBlocks(playHead, blockSize, numBlocks, [&] {
+        midiMessages.clear();
+        processor.processBlock(buffer, midiMessages);
+    });
+
+    processor.releaseResources();
+
+    LegacyTickPulseRenderer legacyRenderer;
+    SimulatedPlayHead legacyPlayHead (sampleRate);
+    legacyPlayHead.setTempoAt(0, 120.0);
+    legacyPlayHead.playAt(0);
+    legacyRenderer.prepare(sampleRate, blockSize);
+
+    auto legacyTimes = timeBlocks(legacyPlayHead, blockSize, numBlocks, [&] {
+        legacyRenderer.process(buffer, legacyPlayHead);
+    });
+
+    return { std::is_same<SampleType, double>::value ? "double" : "float", sampleRate, blockSize, numBlocks,
+             times.totalNs / static_cast<double>(numBlocks * blockSize),
+             times.totalNs / static_cast<double>(numBlocks),
+             times.worstNs,
+             legacyTimes.totalNs / static_cast<double>(numBlocks * blockSize) };
+}
+
+
+//==============================================================================
+struct SyncResult {
+    const char* scenario;
+    const char* blocks;
+    double sampleRate;
+    SyncReport report;
+};
+
+// the dropped and duplicate ticks the lookahead cannot avoid, as the host only tells what happens at its own position, besides
+// the duplicates of the catch-up after each start (SyncReport::numStartDuplicates): a run of these scenarios with the lookahead
+// may have up to that many, any other dropped or duplicate tick fails it
+struct LookaheadExemption {
+    const char* scenario;
+    int maxDropped;
+    int maxDuplicates;
+    const char* reason;
+};
+
+static const LookaheadExemption lookaheadExemptions[] = {
+    // with a lookahead up to a tick long (22.7ms at 110bpm): at most 1 per stop
+    { "stop/start", 0, 6, "the ticks sent in the lookahead before each stop, which the host only reaches after it starts again" },
+    
+    // with a lookahead up to half a tick long (10.4ms at 120bpm): at most 1 per change to or from 7/8
+    { "time sig changes", 1, 1, "the extra tick of 7/8 right after the bar where it starts is not sent, and the one after the bar where it "
+                                "ends is, when the lookahead reaches it before the host gives the new time signature" },
+};
+
+static const LookaheadExemption* findLookaheadExemption (const char* scenario, double lookaheadMs)
+{
+    if (lookaheadMs > 0.0)
+        for (const auto& exemption : lookaheadExemptions)
+            if (std::strcmp(exemption.scenario, scenario) == 0)
+                return &exemption;
+    return nullptr;
+}
+
+// block sizes used by the host: fixed, or changing at every block like some hosts do (e.g. around loop points)
+static int getBlockSize (const char* blocks, int64_t blockIndex)
+{
+    if (std::strcmp(blocks, "variable") == 0)
+        return 1 + static_cast<int>((blockIndex * 7919) % 1024);
+    return std::atoi(blocks);
+}
+
+static SyncResult runSync (const TransportScenario& scenario, double sampleRate, const char* blocks, bool subSampleTicks, double lookaheadMs)
+{
+    MidronomeAudioProcessor processor;
+    processor.setSubSampleTicks(subSampleTicks);
+    processor.setLatencyCompensation(lookaheadMs > 0.0 ? MidronomeAudioProcessor::LatencyCompensation::lookahead
+                                                       : MidronomeAudioProcessor::LatencyCompensation::off, lookaheadMs);
+    SimulatedPlayHead playHead (sampleRate);
+    scenario.script(playHead, sampleRate);
+    processor.setPlayHead(&playHead);
+    processor.prepareToPlay(sampleRate, 1024);
+
+    juce::AudioBuffer<float> buffer (processor.getTotalNumOutputChannels(), 1024);
+    juce::MidiBuffer midiMessages;
+    midiMessages.ensureSize(2048); // like the plugin wrappers do
+    auto lookaheadSamples = std::round(lookaheadMs * 0.001 * sampleRate); // as rounded by the processor
+    PulseDetector detector ((subSampleTicks ? 2.0 : 1.0) - lookaheadSamples);
+
+    auto totalNumSamples = static_cast<int64_t>(scenario.durationSeconds * sampleRate);
+
+    for (int64_t blockIndex = 0; playHead.getSessionSample() < totalNumSamples; blockIndex++) {
+        auto blockSize = getBlockSize(blocks, blockIndex);
+        buffer.setSize(buffer.getNumChannels(), blockSize, false, false, true);
+        midiMessages.clear();
+
+        processor.processBlock(buffer, midiMessages);
+        detector.process(buffer.getReadPointer(0), blockSize);
+        playHead.advance(blockSize);
+    }
+
+    playHead.finish();
+    processor.releaseResources();
+
+    // with the lookahead, the pulses of the ticks right after the end are sent before it, but the playhead never reaches them
+    auto pulses = detector.getEdges();
+    pulses.erase(std::lower_bound(pulses.begin(), pulses.end(), static_cast<double>(playHead.getSessionSample())), pulses.end());
+
+    return { scenario.name, blocks, sampleRate, analyseSync(playHead.getIdealTicks(), pulses, playHead.getPlayingSegments()) };
+}
+
+
+static void writeSyncJson (std::ostream& out, const std::vector<SyncResult>& results, bool subSampleTicks, double lookaheadMs)
+{
+    out << "{\n  \"benchmark\": \"sync\",\n  \"subSampleTicks\": " << (subSampleTicks ? "true" : "false")
+        << ",\n  \"lookaheadMs\": " << lookaheadMs << ",\n  \"results\": [\n";
+
+    for (size_t i = 0; i < results.size(); i++) {
+        const auto& r = results[i];
+        const auto& rep = r.report;
+        char line[512];
+        snprintf(line, sizeof(line),
+                 "    { \"scenario\": \"%s\", \"blocks\": \"%s\", \"sampleRate\": %.0f, \"idealTicks\": %d, \"pulses\": %d, \"dropped\": %d, \"duplicates\": %d, "
+                 "\"meanErrorSamples\": %.4f, \"p99ErrorSamples\": %.4f, \"maxErrorSamples\": %.4f, \"p99JitterSamples\": %.4f, "
+                 "\"meanErrorUs\": %.3f, \"p99ErrorUs\": %.3f, \"maxErrorUs\": %.3f, \"p99JitterUs\": %.3f }%s\n",
+                 r.scenario, r.blocks, r.sampleRate, rep.numIdealTicks, rep.numPulses, rep.numDropped, rep.numDuplicates,
+                 rep.meanError, rep.p99AbsError, rep.maxAbsError, rep.p99Jitter,
+                 rep.toMicroseconds(rep.meanError, r.sampleRate), rep.toMicroseconds(rep.p99AbsError, r.sampleRate), rep.toMicroseconds(rep.maxAbsError, r.sampleRate),
+                 rep.toMicroseconds(rep.p99Jitter, r.sampleRate),
+                 (i + 1 < results.size()) ? "," : "");
+        out << line;
+    }
+
+    out << "  ]\n}\n";
+}
+
+
+static int runSyncScenarios (const char* jsonPath, bool subSampleTicks, double lookaheadMs)
+{
+    const char* blockConfigs[] = { "32", "512", "variable" };
+    const double sampleRate = 48000.0;
+
+    std::vector<SyncResult> results;
+    auto* table = (jsonPath != nullptr && std::strcmp(jsonPath, "-") == 0) ? stderr : stdout; // keep stdout for the JSON
+    auto numFailed = 0;
+
+    fprintf(table, "%-26s %8s %7s %7s %7s %5s %10s %10s %10s %10s %10s\n",
+            "scenario", "blocks", "ticks", "pulses", "dropped", "dup", "mean smp", "p99 smp", "max smp", "max us", "jitter smp");
+
+    for (const auto& scenario : getTransportScenarios()) {
+        for (auto blocks : blockConfigs) {
+            results.push_back(runSync(scenario, sampleRate, blocks, subSampleTicks, lookaheadMs));
+            const auto& rep = results.back().report;
+
+            // every tick must be sent once: only the catch-up after a start, and the exemptions above, may drop or duplicate some
+            const auto* exemption = findLookaheadExemption(scenario.name, lookaheadMs);
+            auto failed = rep.numDropped > (exemption != nullptr ? exemption->maxDropped : 0)
+                          || rep.numDuplicates > rep.numStartDuplicates + (exemption != nullptr ? exemption->maxDuplicates : 0);
+            if (failed)
+                numFailed++;
+
+            fprintf(table, "%-26s %8s %7d %7d %7d %5d %10.3f %10.3f %10.3f %10.1f %10.3f%s\n",
+                    scenario.name, blocks, rep.numIdealTicks, rep.numPulses, rep.numDropped, rep.numDuplicates,
+                    rep.meanError, rep.p99AbsError, rep.maxAbsError, rep.toMicroseconds(rep.maxAbsError, sampleRate), rep.p99Jitter,
+                    failed ? "  <- FAILED" : "");
+            fflush(table);
+        }
+    }
+
+    if (lookaheadMs > 0.0)
+        for (const auto& exemption : lookaheadExemptions)
+            fprintf(table, "exempt with the lookahead: up to %d dropped and %d duplicate ticks in \"%s\", %s\n",
+                    exemption.maxDropped, exemption.maxDuplicates, exemption.scenario, exemption.reason);
+    
+    if (numFailed > 0)
+        fprintf(table, "%d runs dropped or duplicated ticks\n", numFailed);
+
+    if (jsonPath != nullptr) {
+        if (std::strcmp(jsonPath, "-") == 0) {
+            writeSyncJson(std::cout, results, subSampleTicks, lookaheadMs);
+        }
+        else {
+            std::ofstream file (jsonPath);
+            if (!file) {
+                std::cerr << "Cannot write " << jsonPath << std::endl;
+                return 1;
+            }
+            writeSyncJson(file, results, subSampleTicks, lookaheadMs);
+        }
+    }
+
+    return numFailed > 0 ? 1 : 0;
+}
+
+
+//==============================================================================
+// plays 62s from the start (to cross a minute), then 64s from 9:59 (to cross the 10 minutes of drop frame)
+// a run fails if a frame is wrong or dropped, if a frame edge is more than maxLtcErrorSamples away from its host time,
+// or if the frames of more than one of the 126 seconds played are missing (the decoder needs a frame to lock on)
+static constexpr double maxLtcErrorSamples = 1.0; // the edges are on samples, so the error of a right frame is below 1
+
+static bool runLtc (LtcEncoder::FrameRate frameRate, double sampleRate, const char* blocks)
+{
+    MidronomeAudioProcessor processor;
+    processor.setTimecodeFrameRate(frameRate);
+    processor.enableAllBuses();
+
+    auto s = [=] (double seconds) { return static_cast<int64_t>(seconds * sampleRate); };
+    SimulatedPlayHead playHead (sampleRate);
+    playHead.setTempoAt(0, 120.0);
+    playHead.playAt(0);
+    playHead.stopAt(s(62.0));
+    playHead.locateAt(s(63.0), 599.0 * 2.0); // 9:59 at 120bpm
+    playHead.playAt(s(64.0));
+
+    processor.setPlayHead(&playHead);
+    processor.prepareToPlay(sampleRate, 1024);
+
+    juce::AudioBuffer<float> buffer (processor.getTotalNumOutputChannels(), 1024);
+    juce::MidiBuffer midiMessages;
+    midiMessages.ensureSize(2048); // like the plugin wrappers do
+    auto framesPerSecond = LtcEncoder::getFramesPerSecond(frameRate);
+    auto labelFramesPerSecond = static_cast<int>(std::ceil(framesPerSecond));
+    LtcDecoder decoder (sampleRate, framesPerSecond);
+
+    struct Block { int64_t sessionSample, timeInSamples; };
+    std::vector<Block> hostBlocks;
+
+    for (int64_t blockIndex = 0; playHead.getSessionSample() < s(128.0); blockIndex++) {
+        auto blockSize = getBlockSize(blocks, blockIndex);
+        buffer.setSize(buffer.getNumChannels(), blockSize, false, false, true);
+        midiMessages.clear();
+
+        hostBlocks.push_back({ playHead.getSessionSample(), playHead.getPosition()->getTimeInSamples().orFallback(0) });
+        processor.processBlock(buffer, midiMessages);
+        decoder.process(buffer.getReadPointer(processor.getChannelIndexInProcessBlockBuffer(false, 2, 0)), blockSize);
+        playHead.advance(blockSize);
+    }
+
+    processor.releaseResources();
+
+    // host time of a session sample, from the block it is in
+    auto getHostTime = [&hostBlocks] (double sessionSample) {
+        auto block = std::upper_bound(hostBlocks.begin(), hostBlocks.end(), sessionSample,
+                                      [] (double sample, const Block& b) { return sample < static_cast<double>(b.sessionSample); }) - 1;
+        return static_cast<double>(block->timeInSamples) + sessionSample - static_cast<double>(block->sessionSample);
+    };
+
+    const auto& frames = decoder.getFrames();
+    auto samplesPerFrame = sampleRate / framesPerSecond;
+    auto numBad = 0, numDropped = 0;
+    auto maxError = 0.0;
+
+    for (size_t i = 0; i < frames.size(); i++) {
+        auto frameNo = LtcDecoder::getFrameNo(frames[i], labelFramesPerSecond);
+        auto error = getHostTime(frames[i].endSample) - static_cast<double>(frameNo + 1) * samplesPerFrame;
+
+        if (std::abs(error) > 0.5 * samplesPerFrame || frames[i].isDropFrame != (frameRate == LtcEncoder::FrameRate::fps2997drop)) {
+            numBad++;
+            continue;
+        }
+        maxError = std::max(maxError, std::abs(error));
+
+        // frames missing between 2 frames of the same playing segment
+        if (i > 0) {
+            auto hostDelta = getHostTime(frames[i].endSample) - getHostTime(frames[i - 1].endSample);
+            if (std::abs(hostDelta - (frames[i].endSample - frames[i - 1].endSample)) < 1.0)
+                numDropped += static_cast<int>(frameNo - LtcDecoder::getFrameNo(frames[i - 1], labelFramesPerSecond) - 1);
+        }
+    }
+
+    auto passed = numBad == 0 && numDropped == 0 && maxError <= maxLtcErrorSamples
+               && static_cast<double>(frames.size()) >= (126.0 - 1.0) * framesPerSecond;
+
+    const char* names[] = { "24", "25", "29.97df", "30" };
+    printf("%-9s %10.0f %8s %8d %8d %6d %10.3f%s\n", names[static_cast<int>(frameRate)], sampleRate, blocks,
+           static_cast<int>(frames.size()), numDropped, numBad, maxError, passed ? "" : "  <- FAILED");
+    fflush(stdout);
+
+    return passed;
+}
+
+static int runLtcChecks()
+{
+    auto numFailed = 0;
+
+    printf("%-9s %10s %8s %8s %8s %6s %10s\n", "fps", "rate", "blocks", "frames", "dropped", "bad", "max smp");
+
+    for (auto frameRate : { LtcEncoder::FrameRate::fps24, LtcEncoder::FrameRate::fps25, LtcEncoder::FrameRate::fps2997drop, LtcEncoder::FrameRate::fps30 })
+        for (auto sampleRate : { 44100.0, 48000.0, 96000.0 })
+            for (auto blocks : { "512", "variable" })
+                if (! runLtc(frameRate, sampleRate, blocks))
+                    numFailed++;
+
+    if (numFailed > 0)
+        printf("%d runs failed\n", numFailed);
+
+    return numFailed > 0 ? 1 : 0;
+}
+
+
+//==============================================================================
+// an upstream device clocking the plugin: MIDI clock at a tempo changing to newBpm in the middle of the run, each clock
+// received up to jitterMs early or late, and Start after 2s (the clock runs from the beginning if clockBeforeStart)
+// in the time signature of the host, where x/8 expects a tick between each 2 clocks
+struct MidiClockScenario {
+    const char* name;
+    double bpm;
+    double newBpm;
+    double jitterMs;
+    bool clockBeforeStart;
+    int numerator = 4;
+    int denominator = 4;
+};
+
+// a run fails if a tick is dropped or duplicated (besides the catch-up after Start, as with the lookahead), or if the first
+// pulse after Start comes after the acquisition window: the tempo is known from the 2nd clock after Start when the clock
+// starts with it, and the sync starts on bar 0 late within the block that clock is in
+static bool runMidiClock (const MidiClockScenario& scenario, double sampleRate, const char* blocks)
+{
+    MidronomeAudioProcessor processor;
+    processor.setMidiClockInput(true);
+
+    SimulatedPlayHead playHead (sampleRate); // the host transport stays stopped, it only gives the time signature
+    playHead.setTempoAt(0, 120.0);
+    playHead.setTimeSignatureAt(0, scenario.numerator, scenario.denominator);
+    processor.setPlayHead(&playHead);
+    processor.prepareToPlay(sampleRate, 1024);
+
+    juce::AudioBuffer<float> buffer (processor.getTotalNumOutputChannels(), 1024);
+    juce::MidiBuffer midiMessages;
+    midiMessages.ensureSize(2048); // like the plugin wrappers do
+    PulseDetector detector;
+
+    auto totalNumSamples = static_cast<int64_t>(30.0 * sampleRate);
+    auto startSample = static_cast<int64_t>(2.0 * sampleRate);
+    auto tempoChangeSample = totalNumSamples / 2;
+
+    // the ideal clock grid, the clocks as received, and the ticks expected from the first clock after Start
+    std::mt19937 random (1234);
+    std::uniform_real_distribution<double> jitter (-scenario.jitterMs * 0.001 * sampleRate, scenario.jitterMs * 0.001 * sampleRate);
+    std::vector<int64_t> receivedClocks;
+    std::vector<double> idealTicks;
+
+    for (auto time = scenario.clockBeforeStart ? 0.01 * sampleRate : static_cast<double>(startSample) + 0.001 * sampleRate;
+         time < static_cast<double>(totalNumSamples); ) {
+        receivedClocks.push_back(std::max(int64_t { 0 }, static_cast<int64_t>(std::floor(time + jitter(random)))));
+        auto clockPeriod = 60.0 * sampleRate / (24.0 * (time < static_cast<double>(tempoChangeSample) ? scenario.bpm : scenario.newBpm));
+        if (time > static_cast<double>(startSample)) {
+            idealTicks.push_back(time);
+            if (scenario.denominator == 8)
+                idealTicks.push_back(time + 0.5 * clockPeriod);
+        }
+        time += clockPeriod;
+    }
+
+    std::sort(receivedClocks.begin(), receivedClocks.end());
+    auto nextClock = receivedClocks.begin();
+    int64_t blockStart = 0;
+    int maxBlockSize = 0;
+
+    for (int64_t blockIndex = 0; blockStart < totalNumSamples; blockIndex++) {
+        auto blockSize = static_cast<int>(std::min<int64_t>(getBlockSize(blocks, blockIndex), totalNumSamples - blockStart)); // no tick past the clocks
+        buffer.setSize(buffer.getNumChannels(), blockSize, false, false, true);
+        midiMessages.clear();
+        maxBlockSize = std::max(maxBlockSize, blockSize);
+
+        if (startSample >= blockStart && startSample < blockStart + blockSize)
+            midiMessages.addEvent(juce::MidiMessage::midiStart(), static_cast<int>(startSample - blockStart));
+        for (; nextClock != receivedClocks.end() && *nextClock < blockStart + blockSize; nextClock++)
+            midiMessages.addEvent(juce::MidiMessage::midiClock(), static_cast<int>(*nextClock - blockStart));
+
+        processor.processBlock(buffer, midiMessages);
+        detector.process(buffer.getReadPointer(0), blockSize);
+        playHead.advance(blockSize);
+        blockStart += blockSize;
+    }
+
+    processor.releaseResources();
+
+    auto report = analyseSync(idealTicks, detector.getEdges(), { { startSample, totalNumSamples, true } });
+
+    // the lock-in time of the PLL, from the first clock or from the tempo change, and the first pulse after Start
+    auto lockFrom = scenario.newBpm != scenario.bpm ? tempoChangeSample : receivedClocks.front();
+    auto lockSample = processor.getMidiClockFollower().getLockSample();
+    auto lockMs = lockSample >= lockFrom ? static_cast<double>(lockSample - lockFrom) * 1000.0 / sampleRate : -1.0;
+    auto firstPulse = std::lower_bound(detector.getEdges().begin(), detector.getEdges().end(), static_cast<double>(startSample));
+    auto firstPulseMs = firstPulse != detector.getEdges().end() ? (*firstPulse - static_cast<double>(startSample)) * 1000.0 / sampleRate : -1.0;
+
+    auto secondClock = std::upper_bound(receivedClocks.begin(), receivedClocks.end(), startSample) + 1;
+    auto maxFirstPulseSample = secondClock < receivedClocks.end() ? *secondClock + maxBlockSize : totalNumSamples;
+    auto passed = report.numDropped == 0 && report.numDuplicates <= report.numStartDuplicates
+                  && firstPulse != detector.getEdges().end() && *firstPulse <= static_cast<double>(maxFirstPulseSample);
+
+    printf("%-26s %8s %7d %7d %7d %5d %9.1f %9.1f %10.3f %10.3f %10.3f %10.1f %10.3f%s\n",
+           scenario.name, blocks, report.numIdealTicks, report.numPulses, report.numDropped, report.numDuplicates, lockMs, firstPulseMs,
+           report.meanError, report.p99AbsError, report.maxAbsError, report.toMicroseconds(report.maxAbsError, sampleRate), report.p99Jitter,
+           passed ? "" : "  <- FAILED");
+    fflush(stdout);
+
+    return passed;
+}
+
+static int runMidiClockChecks()
+{
+    const MidiClockScenario scenarios[] = {
+        { "120bpm",                     120.0, 120.0, 0.0, true },
+        { "120bpm 1ms jitter",          120.0, 120.0, 1.0, true },
+        { "97.3bpm 2ms jitter",          97.3,  97.3, 2.0, true },
+        { "174bpm 1ms, clock at Start", 174.0, 174.0, 1.0, false },
+        { "120->140bpm 1ms jitter",     120.0, 140.0, 1.0, true },
+        { "140->90bpm 1ms jitter",      140.0,  90.0, 1.0, true },
+        { "7/8 120bpm 1ms jitter",      120.0, 120.0, 1.0, true, 7, 8 },
+        { "7/8 174bpm, clock at Start", 174.0, 174.0, 1.0, false, 7, 8 },
+    };
+
+    printf("%-26s %8s %7s %7s %7s %5s %9s %9s %10s %10s %10s %10s %10s\n",
+           "scenario", "blocks", "ticks", "pulses", "dropped", "dup", "lock ms", "1st ms", "mean smp", "p99 smp", "max smp", "max us", "jitter smp");
+
+    auto numFailed = 0;
+
+    for (const auto& scenario : scenarios)
+        for (auto blocks : { "32", "512", "variable" })
+            if (! runMidiClock(scenario, 48000.0, blocks))
+                numFailed++;
+
+    if (numFailed > 0)
+        printf("%d runs failed\n", numFailed);
+
+    return numFailed > 0 ? 1 : 0;
+}
+
+
+//==============================================================================
+// hours of steady playing in one go, like installations running the clock for days: the mean error of the pulses in the
+// last hour against the first one is the drift, which must stay 0 (within the 1/32 sample of the sub-sample placement)
+struct SoakScenario {
+    const char* name;
+    double bpm;
+    int numerator;
+    int denominator;
+    bool timeInSamples; // some hosts only give the ppq position
+};
+
+static bool runSoak (const SoakScenario& scenario, double hours, double sampleRate)
+{
+    MidronomeAudioProcessor processor;
+    processor.setSubSampleTicks(true); // so the error is measured to a fraction of a sample
+    SimulatedPlayHead playHead (sampleRate);
+    playHead.fields.timeInSamples = scenario.timeInSamples;
+    playHead.fields.timeInSeconds = scenario.timeInSamples;
+    playHead.setTempoAt(0, scenario.bpm);
+    playHead.setTimeSignatureAt(0, scenario.numerator, scenario.denominator);
+    playHead.playAt(0);
+    processor.setPlayHead(&playHead);
+    processor.prepareToPlay(sampleRate, 1024);
+
+    juce::AudioBuffer<float> buffer (processor.getTotalNumOutputChannels(), 1024);
+    juce::MidiBuffer midiMessages;
+    midiMessages.ensureSize(2048);
+    PulseDetector detector (2.0);
+
+    auto totalNumSamples = static_cast<int64_t>(hours * 3600.0 * sampleRate);
+
+    for (int64_t blockIndex = 0; playHead.getSessionSample() < totalNumSamples; blockIndex++) {
+        auto blockSize = getBlockSize("variable", blockIndex);
+        buffer.setSize(buffer.getNumChannels(), blockSize, false, false, true);
+        midiMessages.clear();
+
+        processor.processBlock(buffer, midiMessages);
+        detector.process(buffer.getReadPointer(0), blockSize);
+        playHead.advance(blockSize);
+    }
+
+    playHead.finish();
+    processor.releaseResources();
+
+    const auto& idealTicks = playHead.getIdealTicks();
+    const auto& pulses = detector.getEdges();
+
+    auto analyseHour = [&] (int64_t startSample)
+    {
+        auto endSample = std::min(totalNumSamples, startSample + static_cast<int64_t>(3600.0 * sampleRate));
+        auto inHour = [=] (double sample) { return sample >= static_cast<double>(startSample) && sample < static_cast<double>(endSample); };
+        std::vector<double> hourTicks, hourPulses;
+        std::copy_if(idealTicks.begin(), idealTicks.end(), std::back_inserter(hourTicks), inHour);
+        std::copy_if(pulses.begin(), pulses.end(), std::back_inserter(hourPulses), inHour);
+        return analyseSync(hourTicks, hourPulses, { { startSample, endSample, true } });
+    };
+
+    auto report = analyseSync(idealTicks, pulses, playHead.getPlayingSegments());
+    auto firstHour = analyseHour(0);
+    auto lastHour = analyseHour(std::max<int64_t>(0, totalNumSamples - static_cast<int64_t>(3600.0 * sampleRate)));
+    auto drift = lastHour.meanError - firstHour.meanError;
+    auto isOk = report.numDropped == 0 && report.numDuplicates == 0 && std::abs(drift) < 1.0 / 32.0;
+
+    printf("%-30s %6.1f %9d %9d %7d %5d %12.4f %12.4f %10.4f %10.3f  %s\n",
+           scenario.name, hours, report.numIdealTicks, report.numPulses, report.numDropped, report.numDuplicates,
+           firstHour.meanError, lastHour.meanError, drift, report.maxAbsError, isOk ? "ok" : "FAILED");
+    fflush(stdout);
+    return isOk;
+}
+
+static int runSoaks (double hours)
+{
+    const SoakScenario scenarios[] = {
+        { "120bpm 4/4",                  120.0, 4, 4, true },
+        { "97.3bpm 7/8",                  97.3, 7, 8, true },
+        { "133.7bpm, no timeInSamples",  133.7, 4, 4, false },
+    };
+
+    printf("%-30s %6s %9s %9s %7s %5s %12s %12s %10s %10s\n",
+           "scenario", "hours", "ticks", "pulses", "dropped", "dup", "1st hour smp", "last hour smp", "drift smp", "max smp");
+
+    auto numFailed = 0;
+    for (const auto& scenario : scenarios)
+        numFailed += runSoak(scenario, hours, 48000.0) ? 0 : 1;
+
+    return numFailed > 0 ? 1 : 0;
+}
+
+
+//==============================================================================
+// the fuzzer: random hosts (see FuzzedPlayHead.h) with random block sizes, settings and MIDI input, checking after each
+// block the invariants which must hold whatever the host does - a failing run is replayed with --fuzz 1 --seed <its seed>
+struct FuzzResult {
+    double sampleRate;
+    int blockSize;
+    int64_t numTicks;
+    int64_t failedBlock; // -1 if every invariant held
+    std::string failure;
+};
+
+template <typename SampleType>
+static FuzzResult runFuzz (uint32_t seed, double seconds)
+{
+    const double sampleRates[] = { 22050.0, 44100.0, 48000.0, 88200.0, 96000.0, 176400.0, 192000.0 };
+    const int blockSizes[] = { 16, 32, 64, 128, 256, 441, 512, 1024, 2048, 4096 };
+    using LatencyCompensation = MidronomeAudioProcessor::LatencyCompensation;
+    const LatencyCompensation latencyModes[] = { LatencyCompensation::off, LatencyCompensation::reportToHost, LatencyCompensation::lookahead };
+
+    std::mt19937 random (seed);
+    auto pick = [&random] (const auto& values) { return values[std::uniform_int_distribution<size_t> (0, std::size(values) - 1) (random)]; };
+    auto chance = [&random] (double probability) { return std::uniform_real_distribution<double> (0.0, 1.0) (random) < probability; };
+
+    FuzzResult result { pick(sampleRates), pick(blockSizes), 0, -1, {} };
+    auto sampleRate = result.sampleRate;
+
+    MidronomeAudioProcessor processor;
+    processor.setSubSampleTicks(chance(0.5));
+    processor.setLatencyCompensation(pick(latencyModes), std::uniform_real_distribution<double> (0.0, 50.0) (random));
+    processor.setMidiClockOutput(chance(0.5));
+    processor.setMidiClockInput(chance(0.2));
+    if (chance(0.5))
+        processor.enableAllBuses();
+
+    FuzzedPlayHead playHead (seed ^ 0x9e3779b9u, sampleRate);
+    processor.setPlayHead(&playHead);
+    processor.prepareToPlay(sampleRate, result.blockSize);
+
+    // the buffer given to processBlock is in the middle of a bigger one, whose guard samples must never be written
+    constexpr int guardSamples = 64;
+    constexpr SampleType guardValue = static_cast<SampleType>(-1234.5);
+    constexpr SampleType hostValue = static_cast<SampleType>(7.0); // what the host leaves in the buffer, like an input
+    auto numChannels = processor.getTotalNumOutputChannels();
+    auto channelCapacity = guardSamples + 2 * 4096 + guardSamples;
+    std::vector<SampleType> storage (static_cast<size_t>(numChannels * channelCapacity));
+    std::vector<SampleType*> channels;
+    for (auto channel = 0; channel < numChannels; channel++)
+        channels.push_back(storage.data() + channel * channelCapacity + guardSamples);
+
+    juce::MidiBuffer midiMessages;
+    midiMessages.ensureSize(2048);
+    PulseDetector detector (processor.hasSubSampleTicks() ? 2.0 : 1.0);
+    std::vector<float> pulseChannel;
+
+    // the values the host reported, which the BPM and beats per bar messages must come from
+    std::set<int> reportedBpms, reportedBeatsPerBar;
+    auto clockPeriod = 60.0 * sampleRate / (24.0 * 120.0);
+    auto nextClock = 0.0;
+    auto numEdgesChecked = size_t { 0 };
+    auto lastEdge = -1.0e18;
+    auto isStretchTicking = false; // a tick was sent since the host started running the sync without interruption
+    int64_t blockStart = 0;
+
+    auto fail = [&result] (int64_t blockIndex, std::string failure) {
+        if (result.failedBlock < 0) {
+            result.failedBlock = blockIndex;
+            result.failure = std::move(failure);
+        }
+    };
+
+    auto totalNumSamples = static_cast<int64_t>(seconds * sampleRate);
+
+    for (int64_t blockIndex = 0; blockStart < totalNumSamples && result.failedBlock < 0; blockIndex++) {
+        auto blockSize = playHead.nextBlockSize(result.blockSize);
+        auto isSyncExpected = !processor.hasMidiClockInput() && playHead.isSyncExpected(30.0, 400.0); // the default tempo range
+
+        for (auto channel = 0; channel < numChannels; channel++) {
+            std::fill(channels[static_cast<size_t>(channel)] - guardSamples, channels[static_cast<size_t>(channel)], guardValue);
+            std::fill(channels[static_cast<size_t>(channel)], channels[static_cast<size_t>(channel)] + blockSize, hostValue);
+            std::fill(channels[static_cast<size_t>(channel)] + blockSize, channels[static_cast<size_t>(channel)] + blockSize + guardSamples, guardValue);
+        }
+
+        // the MIDI input: a clock at a random tempo, with Start/Stop/Continue/Song Position Pointer and garbage now and then
+        midiMessages.clear();
+        if (processor.hasMidiClockInput()) {
+            for (; nextClock < static_cast<double>(blockStart + blockSize); nextClock += clockPeriod)
+                midiMessages.addEvent(juce::MidiMessage::midiClock(), static_cast<int>(std::max(0.0, nextClock - static_cast<double>(blockStart))));
+            if (chance(0.002))
+                clockPeriod = 60.0 * sampleRate / (24.0 * std::uniform_real_distribution<double> (10.0, 500.0) (random));
+            if (blockSize > 0 && chance(0.02)) {
+                const uint8_t messages[][3] = { { 0xfa, 0, 0 }, { 0xfb, 0, 0 }, { 0xfc, 0, 0 }, { 0xf2, 0x10, 0x02 }, { 0xf2, 0x7f, 0x7f }, { 0x90, 60, 100 } };
+                const auto& message = pick(messages);
+                auto numBytes = message[0] == 0xf2 ? (chance(0.2) ? 1 : 3) : (message[0] == 0x90 ? 3 : 1); // a truncated Song Position Pointer
+                midiMessages.addEvent(message, numBytes, std::uniform_int_distribution<int> (0, blockSize - 1) (random));
+            }
+        }
+
+        if (auto info = playHead.getPosition()) {
+            auto bpm = info->getBpm().orFallback(0.0);
+            for (auto factor : { 1.0, 2.0 }) // doubled in x/8
+                if (std::isfinite(bpm) && bpm * factor >= 30.0 && bpm * factor <= 400.0)
+                    reportedBpms.insert(static_cast<int>(std::round(bpm * factor)));
+            if (auto timeSig = info->getTimeSignature(); timeSig.hasValue() && timeSig->numerator > 0 && timeSig->denominator > 0)
+                reportedBeatsPerBar.insert(timeSig->denominator == 8 ? timeSig->numerator : (4 * timeSig->numerator) / timeSig->denominator);
+        }
+
+        juce::AudioBuffer<SampleType> buffer (channels.data(), numChannels, blockSize);
+        processor.processBlock(buffer, midiMessages);
+
+        // no write outside of the buffer, and nothing left from the host or out of range in it
+        for (auto channel = 0; channel < numChannels; channel++) {
+            const auto* data = channels[static_cast<size_t>(channel)];
+            for (auto i = -guardSamples; i < blockSize + guardSamples; i++) {
+                auto isInBlock = i >= 0 && i < blockSize;
+                if (!isInBlock && data[i] != guardValue)
+                    fail(blockIndex, "channel " + std::to_string(channel) + " written at sample " + std::to_string(i) + " of a " + std::to_string(blockSize) + " samples block");
+                else if (isInBlock && !(std::abs(data[i]) <= 1.0))
+                    fail(blockIndex, "channel " + std::to_string(channel) + " sample " + std::to_string(i) + " is " + std::to_string(static_cast<double>(data[i])));
+            }
+        }
+
+        // valid MIDI in the block, and the BPM and beats per bar encoded as the Midronome expects them
+        auto tempoControllerValue = -1;
+        for (const auto metadata : midiMessages) {
+            const auto* data = metadata.data;
+            if (metadata.samplePosition < 0 || metadata.samplePosition >= blockSize)
+                fail(blockIndex, "MIDI event at sample " + std::to_string(metadata.samplePosition) + " of a " + std::to_string(blockSize) + " samples block");
+            if (metadata.numBytes < 1 || data[0] < 0x80 || std::any_of(data + 1, data + metadata.numBytes, [] (uint8_t b) { return b >= 0x80; }))
+                fail(blockIndex, "invalid MIDI message");
+
+            if (metadata.numBytes == 3 && data[0] == 0xbb && (data[1] == 85 || data[1] == 86)) { // 128*CC85 + CC86 is the BPM
+                tempoControllerValue = (data[1] == 85) ? data[2] * 128 : std::max(0, tempoControllerValue) + data[2];
+            }
+            else if (metadata.numBytes == 3 && data[0] == 0xbb && data[1] == 90) {
+                if (reportedBeatsPerBar.count(data[2]) == 0)
+                    fail(blockIndex, "beats per bar CC " + std::to_string(data[2]) + " never reported by the host");
+            }
+            else if (metadata.numBytes == 3 && data[0] == 0xeb) {
+                auto value = data[1] | (data[2] << 7);
+                if ((value >> 7) == 0x7f) {
+                    if (reportedBeatsPerBar.count(value & 0x7f) == 0 || (value & 0x7f) == 0)
+                        fail(blockIndex, "beats per bar " + std::to_string(value & 0x7f) + " never reported by the host");
+                }
+                else {
+                    if (value < 30 || value > 400 || (!processor.hasMidiClockInput() && reportedBpms.count(value) == 0))
+                        fail(blockIndex, "BPM " + std::to_string(value) + " never reported by the host");
+                    if (PluginOutputs::tempoControllers && tempoControllerValue != value)
+                        fail(blockIndex, "BPM " + std::to_string(value) + " sent as " + std::to_string(tempoControllerValue) + " in CC85/86");
+                }
+                tempoControllerValue = -1;
+            }
+        }
+
+        // the ticks: never closer than a tick at the maximum tempo, and while the host runs the sync, never further than
+        // a tick at the minimum tempo (1 sample more or less for the placement of the pulse edges)
+        if (numChannels == 0) { // the MIDI effect has no audio output
+        }
+        else if (std::is_same<SampleType, float>::value) {
+            detector.process(reinterpret_cast<const float*>(channels[0]), blockSize);
+        }
+        else {
+            pulseChannel.assign(channels[0], channels[0] + blockSize);
+            detector.process(pulseChannel.data(), blockSize);
+        }
+
+        auto minSamples = static_cast<double>(processor.getMinSamplesBetweenTicks());
+        auto maxSamples = static_cast<double>(processor.getMaxSamplesBetweenTicks());
+        for (const auto& edges = detector.getEdges(); numEdgesChecked < edges.size(); numEdgesChecked++) {
+            auto edge = edges[numEdgesChecked];
+            if (edge - lastEdge < minSamples - 1.0)
+                fail(blockIndex, "ticks " + std::to_string(edge - lastEdge) + " samples apart, minimum " + std::to_string(minSamples));
+            if (isSyncExpected && isStretchTicking && edge - lastEdge > maxSamples + 1.0)
+                fail(blockIndex, "ticks " + std::to_string(edge - lastEdge) + " samples apart while playing, maximum " + std::to_string(maxSamples));
+            lastEdge = edge;
+            isStretchTicking = isSyncExpected;
+            result.numTicks++;
+        }
+
+        blockStart += blockSize;
+        if (isSyncExpected && isStretchTicking && static_cast<double>(blockStart) - lastEdge > maxSamples + 1.0)
+            fail(blockIndex, "no tick for " + std::to_string(static_cast<double>(blockStart) - lastEdge) + " samples while playing, maximum " + std::to_string(maxSamples));
+        isStretchTicking = isStretchTicking && isSyncExpected;
+
+        playHead.advance(blockSize);
+    }
+
+    processor.releaseResources();
+    return result;
+}
+
+static int runFuzzer (int numRuns, uint32_t firstSeed)
+{
+    constexpr double secondsPerRun = 60.0;
+    auto numFailed = 0;
+
+    printf("%10s %9s %6s %9s %8s  %s\n", "seed", "rate", "block", "precision", "ticks", "result");
+
+    for (auto run = 0; run < numRuns; run++) {
+        auto seed = firstSeed + static_cast<uint32_t>(run);
+        auto doublePrecision = (seed % 2) == 1;
+        auto result = doublePrecision ? runFuzz<double>(seed, secondsPerRun) : runFuzz<float>(seed, secondsPerRun);
+
+        printf("%10u %9.0f %6d %9s %8lld  %s\n", seed, result.sampleRate, result.blockSize, doublePrecision ? "double" : "float",
+               static_cast<long long>(result.numTicks),
+               result.failedBlock < 0 ? "ok" : ("FAILED at block " + std::to_string(result.failedBlock) + ": " + result.failure).c_str());
+        fflush(stdout);
+
+        if (result.failedBlock >= 0)
+            numFailed++;
+    }
+
+    printf("%d of %d runs failed\n", numFailed, numRuns);
+    return numFailed > 0 ? 1 : 0;
+}
+
+
+//==============================================================================
+// runs a transport scenario with every output enabled, and counts the heap calls made inside processBlock
+// the host prepares for 256 samples blocks but sends bigger ones too, like some hosts do
+template <typename SampleType>
+static int64_t runAllocationGuard (const TransportScenario& scenario, double sampleRate, const char* blocks, bool allFeatures)
+{
+    MidronomeAudioProcessor processor;
+    processor.setSubSampleTicks(allFeatures);
+    processor.setLatencyCompensation(allFeatures ? MidronomeAudioProcessor::LatencyCompensation::lookahead
+                                                 : MidronomeAudioProcessor::LatencyCompensation::off, 10.0);
+    processor.setMidiClockOutput(allFeatures);
+    if (allFeatures)
+        processor.enableAllBuses();
+
+    SimulatedPlayHead playHead (sampleRate);
+    scenario.script(playHead, sampleRate);
+    processor.setPlayHead(&playHead);
+    processor.prepareToPlay(sampleRate, 256);
+
+    juce::AudioBuffer<SampleType> buffer (processor.getTotalNumOutputChannels(), 4096);
+    juce::MidiBuffer midiMessages;
+    midiMessages.ensureSize(2048); // like the plugin wrappers do
+
+    auto totalNumSamples = static_cast<int64_t>(scenario.durationSeconds * sampleRate);
+    auto numHeapCalls = AllocationGuard::getNumAllocations() + AllocationGuard::getNumDeallocations();
+
+    for (int64_t blockIndex = 0; playHead.getSessionSample() < totalNumSamples; blockIndex++) {
+        auto blockSize = getBlockSize(blocks, blockIndex);
+        buffer.setSize(buffer.getNumChannels(), blockSize, false, false, true);
+        midiMessages.clear();
+
+        {
+            AllocationGuard::ScopedCheck check;
+            processor.processBlock(buffer, midiMessages);
+        }
+        playHead.advance(blockSize);
+    }
+
+    processor.releaseResources();
+
+    return AllocationGuard::getNumAllocations() + AllocationGuard::getNumDeallocations() - numHeapCalls;
+}
+
+static int runAllocationGuards()
+{
+    const char* blockConfigs[] = { "32", "variable", "4096" };
+    auto numFailed = 0;
+
+    printf("%-26s %9s %8s %9s %10s\n", "scenario", "precision", "blocks", "features", "heap calls");
+
+    for (const auto& scenario : getTransportScenarios()) {
+        for (auto blocks : blockConfigs) {
+            for (auto allFeatures : { false, true }) {
+                for (auto doublePrecision : { false, true }) {
+                    auto numHeapCalls = doublePrecision ? runAllocationGuard<double>(scenario, 48000.0, blocks, allFeatures)
+                                                        : runAllocationGuard<float>(scenario, 48000.0, blocks, allFeatures);
+                    printf("%-26s %9s %8s %9s %10lld%s\n", scenario.name, doublePrecision ? "double" : "float", blocks,
+                           allFeatures ? "all" : "default", static_cast<long long>(numHeapCalls),
+                           numHeapCalls > 0 ? "  <- FAILED" : "");
+                    fflush(stdout);
+
+                    if (numHeapCalls > 0)
+                        numFailed++;
+                }
+            }
+        }
+    }
+
+    if (numFailed > 0)
+        printf("%d runs allocated or freed memory in processBlock (last allocation: %zu bytes)\n", numFailed, AllocationGuard::getLastAllocationSize());
+
+    return numFailed > 0 ? 1 : 0;
+}
+
+
+//==============================================================================
+// the memory written per block with 1, 2 and 8 channels in the main output: before each block, every sample of the
+// buffer (and of the staging array of the legacy renderer) is set to a value no renderer outputs, and the samples which
+// no longer hold it after the block were written, once or more
+struct TrafficResult {
+    int numChannels;
+    int blockSize;
+    double bytesPerBlock;
+    double pulseBytesPerBlock; // the samples of the pulses, the only ones written if the host's buffer was already cleared
+    double legacyBytesPerBlock;
+};
+
+static constexpr float trafficSentinel = 1234.5f; // out of the range of the pulses
+
+static void fillWithSentinel (float* data, int numSamples)
+{
+    std::fill(data, data + numSamples, trafficSentinel);
+}
+
+static int64_t countWrittenSamples (const float* data, int numSamples)
+{
+    return std::count_if(data, data + numSamples, [] (float sample) { return sample != trafficSentinel; });
+}
+
+static bool runMemoryTraffic (int numChannels, int blockSize, double seconds, TrafficResult& result)
+{
+    const double sampleRate = 48000.0;
+    auto numBlocks = std::max<int64_t>(1, static_cast<int64_t>(seconds * sampleRate) / blockSize);
+
+    MidronomeAudioProcessor processor;
+    if (! processor.setChannelLayoutOfBus(false, 0, juce::AudioChannelSet::discreteChannels(numChannels)))
+        return false;
+
+    SimulatedPlayHead playHead (sampleRate);
+    playHead.setTempoAt(0, 120.0);
+    playHead.playAt(0);
+    processor.setPlayHead(&playHead);
+    processor.prepareToPlay(sampleRate, blockSize);
+
+    LegacyTickPulseRenderer legacyRenderer;
+    SimulatedPlayHead legacyPlayHead (sampleRate);
+    legacyPlayHead.setTempoAt(0, 120.0);
+    legacyPlayHead.playAt(0);
+    legacyRenderer.prepare(sampleRate, blockSize);
+
+    juce::AudioBuffer<float> buffer (processor.getTotalNumOutputChannels(), blockSize);
+    juce::MidiBuffer midiMessages;
+    midiMessages.ensureSize(2048); // like the plugin wrappers do
+
+    int64_t numWritten = 0;
+    int64_t numPulseSamples = 0;
+    int64_t numLegacyWritten = 0;
+
+    for (int64_t blockIndex = 0; blockIndex < numBlocks; blockIndex++) {
+        for (auto ch = 0; ch < buffer.getNumChannels(); ch++)
+            fillWithSentinel(buffer.getWritePointer(ch), blockSize);
+
+        midiMessages.clear();
+        processor.processBlock(buffer, midiMessages);
+        playHead.advance(blockSize);
+
+        for (auto ch = 0; ch < buffer.getNumChannels(); ch++) {
+            auto* data = buffer.getReadPointer(ch);
+            numWritten += countWrittenSamples(data, blockSize);
+            numPulseSamples += std::count_if(data, data + blockSize, [] (float sample) { return sample != 0.0f && sample != trafficSentinel; });
+        }
+
+        for (auto ch = 0; ch < buffer.getNumChannels(); ch++)
+            fillWithSentinel(buffer.getWritePointer(ch), blockSize);
+        fillWithSentinel(legacyRenderer.getOutputData().data(), blockSize);
+
+        legacyRenderer.process(buffer, legacyPlayHead);
+        legacyPlayHead.advance(blockSize);
+
+        for (auto ch = 0; ch < buffer.getNumChannels(); ch++)
+            numLegacyWritten += countWrittenSamples(buffer.getReadPointer(ch), blockSize);
+        numLegacyWritten += countWrittenSamples(legacyRenderer.getOutputData().data(), blockSize);
+    }
+
+    processor.releaseResources();
+
+    auto toBytesPerBlock = [numBlocks] (int64_t numSamples) { return static_cast<double>(numSamples) * sizeof(float) / static_cast<double>(numBlocks); };
+    result = { numChannels, blockSize, toBytesPerBlock(numWritten), toBytesPerBlock(numPulseSamples), toBytesPerBlock(numLegacyWritten) };
+    return true;
+}
+
+static int runMemoryTrafficChecks (double seconds)
+{
+    const int channelCounts[] = { 1, 2, 8 };
+    const int blockSizes[] = { 64, 512, 4096 };
+
+    printf("%8s %8s %12s %18s %19s\n", "channels", "block", "bytes/block", "pulse bytes/block", "legacy bytes/block");
+
+    for (auto numChannels : channelCounts) {
+        for (auto blockSize : blockSizes) {
+            TrafficResult r;
+            if (! runMemoryTraffic(numChannels, blockSize, seconds, r)) {
+                printf("%8d %8d  <- FAILED: the main output does not support %d channels\n", numChannels, blockSize, numChannels);
+                return 1;
+            }
+
+            printf("%8d %8d %12.1f %18.1f %19.1f\n", r.numChannels, r.blockSize, r.bytesPerBlock, r.pulseBytesPerBlock, r.legacyBytesPerBlock);
+            fflush(stdout);
+        }
+    }
+
+    return 0;
+}
+
+//==============================================================================
+// the settings of an instance of the --multi-instance runs, and everything it outputs: each block's channels one after
+// the other, and the MIDI events (their position in the run, then their bytes)
+struct InstanceSettings {
+    const TransportScenario* scenario;
+    const char* blocks;
+    bool subSampleTicks;
+    double lookaheadMs;
+};
+
+struct InstanceOutput {
+    std::vector<float> samples;
+    std::vector<uint8_t> midi;
+};
+
+// prepares an instance, then waits for numInstances instances to be ready, so they all process their blocks at once
+static InstanceOutput runInstance (const InstanceSettings& settings, double sampleRate, double seconds, std::atomic<int>& numReady, int numInstances)
+{
+    MidronomeAudioProcessor processor;
+    processor.setSubSampleTicks(settings.subSampleTicks);
+    processor.setLatencyCompensation(settings.lookaheadMs > 0.0 ? MidronomeAudioProcessor::LatencyCompensation::lookahead
+                                                                : MidronomeAudioProcessor::LatencyCompensation::off, settings.lookaheadMs);
+    processor.setMidiClockOutput(true);
+    processor.enableAllBuses();
+
+    SimulatedPlayHead playHead (sampleRate);
+    settings.scenario->script(playHead, sampleRate);
+    processor.setPlayHead(&playHead);
+    processor.prepareToPlay(sampleRate, 1024);
+
+    juce::AudioBuffer<float> buffer (processor.getTotalNumOutputChannels(), 1024);
+    juce::MidiBuffer midiMessages;
+    midiMessages.ensureSize(2048); // like the plugin wrappers do
+
+    auto totalNumSamples = static_cast<int64_t>(std::min(seconds, settings.scenario->durationSeconds) * sampleRate);
+    InstanceOutput output;
+    output.samples.reserve(static_cast<size_t>(totalNumSamples + 1024) * static_cast<size_t>(buffer.getNumChannels()));
+
+    numReady++;
+    while (numReady.load() < numInstances)
+        std::this_thread::yield();
+
+    for (int64_t blockIndex = 0; playHead.getSessionSample() < totalNumSamples; blockIndex++) {
+        auto blockSize = getBlockSize(settings.blocks, blockIndex);
+        buffer.setSize(buffer.getNumChannels(), blockSize, false, false, true);
+        midiMessages.clear();
+
+        processor.processBlock(buffer, midiMessages);
+
+        for (auto ch = 0; ch < buffer.getNumChannels(); ch++)
+            output.samples.insert(output.samples.end(), buffer.getReadPointer(ch), buffer.getReadPointer(ch) + blockSize);
+
+        for (const auto metadata : midiMessages) {
+            auto position = playHead.getSessionSample() + metadata.samplePosition;
+            auto* positionBytes = reinterpret_cast<const uint8_t*>(&position);
+            output.midi.insert(output.midi.end(), positionBytes, positionBytes + sizeof(position));
+            output.midi.insert(output.midi.end(), metadata.data, metadata.data + metadata.numBytes);
+        }
+
+        playHead.advance(blockSize);
+    }
+
+    processor.releaseResources();
+    return output;
+}
+
+// the index of the first sample whose bits differ (so -0 is not 0, and a NaN is never equal), or -1 if they are identical
+static int64_t findFirstDifference (const std::vector<float>& a, const std::vector<float>& b)
+{
+    auto size = std::min(a.size(), b.size());
+    for (size_t i = 0; i < size; i++)
+        if (std::memcmp(&a[i], &b[i], sizeof(float)) != 0)
+            return static_cast<int64_t>(i);
+    return a.size() == b.size() ? -1 : static_cast<int64_t>(size);
+}
+
+// each instance uses one of 4 settings, which are first run one after the other on the main thread as the reference
+static int runMultiInstance (int numInstances, double seconds)
+{
+    const double sampleRate = 48000.0;
+    const char* blockConfigs[] = { "32", "512", "variable", "variable" };
+    auto scenarios = getTransportScenarios();
+
+    std::vector<InstanceSettings> settings;
+    for (size_t k = 0; k < 4; k++)
+        settings.push_back({ &scenarios[k * scenarios.size() / 4], blockConfigs[k], (k & 1) != 0, (k & 2) != 0 ? 10.0 : 0.0 });
+
+    std::vector<InstanceOutput> references;
+    for (const auto& s : settings) {
+        std::atomic<int> numReady { 0 };
+        references.push_back(runInstance(s, sampleRate, seconds, numReady, 1));
+    }
+
+    std::vector<InstanceOutput> outputs (static_cast<size_t>(numInstances));
+    std::vector<std::thread> threads;
+    std::atomic<int> numReady { 0 };
+
+    for (auto i = 0; i < numInstances; i++) {
+        threads.emplace_back([&, i]
+        {
+            outputs[static_cast<size_t>(i)] = runInstance(settings[static_cast<size_t>(i) % settings.size()], sampleRate, seconds, numReady, numInstances);
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    auto numFailed = 0;
+    printf("%8s %-26s %8s %10s %9s %10s %7s  %s\n", "instance", "scenario", "blocks", "sub-sample", "lookahead", "samples", "MIDI", "output");
+
+    for (auto i = 0; i < numInstances; i++) {
+        const auto& s = settings[static_cast<size_t>(i) % settings.size()];
+        const auto& output = outputs[static_cast<size_t>(i)];
+        const auto& reference = references[static_cast<size_t>(i) % settings.size()];
+        auto firstDifference = findFirstDifference(output.samples, reference.samples);
+        auto isMidiIdentical = output.midi == reference.midi;
+
+        char result[64];
+        if (firstDifference >= 0)
+            snprintf(result, sizeof(result), "FAILED: differs from sample %lld", static_cast<long long>(firstDifference));
+        else if (!isMidiIdentical)
+            snprintf(result, sizeof(result), "FAILED: MIDI differs");
+        else
+            snprintf(result, sizeof(result), "identical");
+
+        printf("%8d %-26s %8s %10s %9.1f %10zu %7zu  %s\n", i + 1, s.scenario->name, s.blocks, s.subSampleTicks ? "on" : "off", s.lookaheadMs,
+               output.samples.size(), output.midi.size(), result);
+
+        if (firstDifference >= 0 || !isMidiIdentical)
+            numFailed++;
+    }
+
+    if (numFailed > 0)
+        printf("%d of %d instances differ from their single-threaded run\n", numFailed, numInstances);
+
+    return numFailed > 0 ? 1 : 0;
+}
+
+
+//==============================================================================
+static int dumpTrace (const char* path)
+{
+    auto file = juce::File (juce::String (path));
+    juce::FileInputStream in (file);
+    uint32_t header[4] = {};
+
+    if (in.failedToOpen() || in.read(header, static_cast<int>(sizeof(header))) != static_cast<int>(sizeof(header))
+        || header[0] != 0x5254444D || header[1] != TelemetryRecorder::formatVersion || header[2] != sizeof(TelemetryRecorder::Event)) {
+        std::cerr << "Not a Midronome trace file (or another version): " << path << std::endl;
+        return 1;
+    }
+
+    const char* types[] = { "?", "prepare", "block", "tick", "overflow" };
+    std::cout << "type,ppqPos,bpm,timeInSamples,tickNo,sampleOffset,flags\n";
+
+    TelemetryRecorder::Event e;
+    while (in.read(&e, static_cast<int>(sizeof(e))) == static_cast<int>(sizeof(e))) {
+        char line[256];
+        snprintf(line, sizeof(line), "%s,%.9f,%.6f,%lld,%lld,%d,0x%02x\n",
+                 types[e.type < 5 ? e.type : 0], e.ppqPos, e.bpm, static_cast<long long>(e.timeInSamples),
+                 static_cast<long long>(e.tickNo), static_cast<int>(e.sampleOffset), static_cast<unsigned int>(e.flags));
+        std::cout << line;
+    }
+
+    return 0;
+}
+
+
+//==============================================================================
+static void writeJson (std::ostream& out, const std::vector<BenchResult>& results, double seconds)
+{
+    out << "{\n  \"benchmark\": \"processBlock\",\n  \"secondsPerRun\": " << seconds << ",\n  \"results\": [\n";
+
+    for (size_t i = 0; i < results.size(); i++) {
+        const auto& r = results[i];
+        char line[256];
+        snprintf(line, sizeof(line),
+                 "    { \"precision\": \"%s\", \"sampleRate\": %.0f, \"blockSize\": %d, \"numBlocks\": %lld, \"nsPerSample\": %.3f, \"nsPerBlock\": %.1f, \"worstNsPerBlock\": %.0f, \"legacyNsPerSample\": %.3f, \"slowerThanLegacy\": %s }%s\n",
+                 r.precision, r.sampleRate, r.blockSize, static_cast<long long>(r.numBlocks), r.nsPerSample, r.nsPerBlock, r.worstNsPerBlock, r.legacyNsPerSample,
+                 r.isSlowerThanLegacy() ? "true" : "false",
+                 (i + 1 < results.size()) ? "," : "");
+        out << line;
+    }
+
+    out << "  ]\n}\n";
+}
+
+
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    double seconds = 60.0;
+    const char* jsonPath = nullptr;
+    bool sync = false;
+    bool subSampleTicks = false;
+    double lookaheadMs = 0.0;
+    auto fuzzRuns = 0;
+    uint32_t fuzzSeed = 1;
+    auto numInstances = 0;
+    auto hasSeconds = false;
+    auto memoryTraffic = false;
+
+    for (auto i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--sync") == 0)
+            sync = true;
+        else if (std::strcmp(argv[i], "--sub-sample") == 0)
+            subSampleTicks = true;
+        else if (std::strcmp(argv[i], "--lookahead") == 0 && i + 1 < argc)
+            lookaheadMs = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--ltc") == 0)
+            return runLtcChecks();
+        else if (std::strcmp(argv[i], "--midi-clock") == 0)
+            return runMidiClockChecks();
+        else if (std::strcmp(argv[i], "--alloc-guard") == 0)
+            return runAllocationGuards();
+        else if (std::strcmp(argv[i], "--memory-traffic") == 0)
+            memoryTraffic = true;
+        else if (std::strcmp(argv[i], "--soak") == 0)
+            return runSoaks(i + 1 < argc ? std::atof(argv[i + 1]) : 24.0);
+        else if (std::strcmp(argv[i], "--fuzz") == 0)
+            fuzzRuns = (i + 1 < argc && std::isdigit(static_cast<unsigned char>(argv[i + 1][0]))) ? std::atoi(argv[++i]) : 200;
+        else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+            fuzzSeed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        else if (std::strcmp(argv[i], "--multi-instance") == 0)
+            numInstances = (i + 1 < argc && std::isdigit(static_cast<unsigned char>(argv[i + 1][0]))) ? std::max(1, std::atoi(argv[++i])) : 8;
+        else if (std::strcmp(argv[i], "--dump-trace") == 0 && i + 1 < argc)
+            return dumpTrace(argv[++i]);
+        else if (std::strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = std::atof(argv[++i]);
+            hasSeconds = true;
+        }
+        else if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+            jsonPath = argv[++i];
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--sync] [--sub-sample] [--lookahead <ms>] [--seconds <audio seconds per run>] [--json <file>|-]" << std::endl
+                      << "       " << argv[0] << " --ltc" << std::endl
+                      << "       " << argv[0] << " --midi-clock" << std::endl
+                      << "       " << argv[0] << " --alloc-guard" << std::endl
+                      << "       " << argv[0] << " --memory-traffic [--seconds <audio seconds per run>]" << std::endl
+                      << "       " << argv[0] << " --soak [<hours>]" << std::endl
+                      << "       " << argv[0] << " --fuzz [<runs>] [--seed <first seed>]" << std::endl
+                      << "       " << argv[0] << " --multi-instance [<instances>] [--seconds <audio seconds per instance>]" << std::endl
+                      << "       " << argv[0] << " --dump-trace <file>" << std::endl;
+            return 1;
+        }
+    }
+
+    if (fuzzRuns > 0)
+        return runFuzzer(fuzzRuns, fuzzSeed);
+    if (memoryTraffic)
+        return runMemoryTrafficChecks(hasSeconds ? seconds : 10.0);
+    if (numInstances > 0)
+        return runMultiInstance(numInstances, hasSeconds ? seconds : 10.0); // every output of every instance is kept in memory
+    if (sync)
+        return runSyncScenarios(jsonPath, subSampleTicks, lookaheadMs);
+
+    const double sampleRates[] = { 44100.0, 48000.0, 88200.0, 96000.0, 176400.0, 192000.0 };
+    const int blockSizes[] = { 1, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192 };
+
+    std::vector<BenchResult> results;
+    auto* table = (jsonPath != nullptr && std::strcmp(jsonPath, "-") == 0) ? stderr : stdout; // keep stdout for the JSON
+
+    fprintf(table, "%9s %10s %8s %12s %12s %14s %17s\n", "precision", "rate", "block", "ns/sample", "ns/block", "worst ns/block", "legacy ns/sample");
+
+    for (auto doublePrecision : { false, true }) {
+        for (auto sampleRate : sampleRates) {
+            for (auto blockSize : blockSizes) {
+                results.push_back(doublePrecision ? runBench<double>(sampleRate, blockSize, seconds, subSampleTicks)
+                                                  : runBench<float>(sampleRate, blockSize, seconds, subSampleTicks));
+                const auto& r = results.back();
+                fprintf(table, "%9s %10.0f %8d %12.3f %12.1f %14.0f %17.3f%s\n", r.precision, r.sampleRate, r.blockSize, r.nsPerSample, r.nsPerBlock, r.worstNsPerBlock, r.legacyNsPerSample,
+                        r.isSlowerThanLegacy() ? "  slower" : "");
+                fflush(table);
+            }
+        }
+    }
+    
+    // the block renderer must not cost more per sample than the legacy one at any block size: the block sizes where it
+    // does in any run are reported (a warning rather than a failure, as a busy machine can slow down a single run)
+    std::set<int> slowerBlockSizes;
+    for (const auto& r : results)
+        if (r.isSlowerThanLegacy())
+            slowerBlockSizes.insert(r.blockSize);
+    
+    if (!slowerBlockSizes.empty()) {
+        fprintf(table, "Warning: slower than the legacy renderer with blocks of");
+        for (auto blockSize : slowerBlockSizes)
+            fprintf(table, " %d", blockSize);
+        fprintf(table, " samples (the runs marked \"slower\")\n");
+    }
+
+    if (jsonPath != nullptr) {
+        if (std::strcmp(jsonPath, "-") == 0) {
+            writeJson(std::cout, results, seconds);
+        }
+        else {
+            std::ofstream file (jsonPath);
+            if (!file) {
+                std::cerr << "Cannot write " << jsonPath << std::endl;
+                return 1;
+            }
+            writeJson(file, results, seconds);
+        }
+    }
+
+    return 0;
+}
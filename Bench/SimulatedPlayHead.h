@@ -0,0 +1,320 @@
+/*
+    ==============================================================================
+
+    This file is part of the Midronome plugin, a VST3/AU/AAX plugin for Digital
+    Audio Workstations (DAW) whose purpose is to synchronize DAWs with the
+    Midronome (more info on <https://www.midronome.com/>).
+
+    Copyright © 2023 - Simon Lasnier (Midronome ApS)
+
+    The Midronome plugin is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option) any
+    later version.
+
+    The Midronome plugin is distributed in the hope that it will be useful, but
+    WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+    details.
+
+    You should have received a copy of the GNU General Public License along with
+    the Midronome plugin. If not, see <https://www.gnu.org/licenses/>.
+
+    ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+//==============================================================================
+/**
+    A scripted DAW transport, standing in for the host's juce::AudioPlayHead.
+
+    The script is a list of events at "session" sample positions, i.e. counted
+    from the start of the simulation whatever the transport does: play/stop,
+    relocations (negative ppq for pre-rolls), tempo changes and ramps, time
+    signature changes, and a loop with getLoopPoints(). Like hosts do, the
+    events take effect at the start of the first block at or after their
+    sample, while tempo ramps and loop wraps happen inside blocks: call
+    advance() after each processBlock().
+
+    While advancing, the playhead records the exact (fractional) session
+    sample of every point of the ideal 24ppq grid it goes through - plus the
+    half ticks in x/8 time signatures - so the emitted pulses can be checked
+    against them.
+*/
+class SimulatedPlayHead : public juce::AudioPlayHead
+{
+public:
+    // optional fields reported to the plugin, some hosts do not provide all of them
+    struct Fields {
+        bool bpm = true;
+        bool timeSignature = true;
+        bool timeInSamples = true;
+        bool timeInSeconds = true;
+        bool ppqPosition = true;
+        bool ppqPositionOfLastBarStart = true;
+        bool loopPoints = true;
+    };
+
+    // a period during which the transport was playing without discontinuity (no stop, relocation or loop wrap)
+    struct PlayingSegment {
+        int64_t startSample;
+        int64_t endSample;
+        bool startsFromStop; // false if it starts with a relocation or a loop wrap while playing
+    };
+
+    explicit SimulatedPlayHead (double sr) : sampleRate (sr) {}
+
+    //==============================================================================
+    void playAt (int64_t sample)                            { addEvent(sample, Event::play); }
+    void stopAt (int64_t sample)                            { addEvent(sample, Event::stop); }
+    void locateAt (int64_t sample, double ppqPos)           { addEvent(sample, Event::locate, ppqPos); }
+    void setTempoAt (int64_t sample, double bpm)            { addEvent(sample, Event::tempo, bpm); }
+    void setTimeSignatureAt (int64_t sample, int num, int den) { addEvent(sample, Event::timeSignature, num, den); }
+
+    // linear tempo change from the current tempo at startSample to endBpm at endSample
+    void rampTempo (int64_t startSample, int64_t endSample, double endBpm) {
+        addEvent(startSample, Event::rampStart, endBpm, static_cast<double>(endSample));
+        addEvent(endSample, Event::tempo, endBpm);
+    }
+
+    void setLoop (double ppqStart, double ppqEnd) {
+        loopStart = ppqStart;
+        loopEnd = ppqEnd;
+        isLooping = true;
+    }
+
+    // the reported timeInSamples will be off by up to maxSamples, like some hosts do
+    void setTimeInSamplesJitter (int maxSamples, unsigned int seed) {
+        jitter = maxSamples;
+        random.seed(seed);
+    }
+
+    Fields fields;
+
+    //==============================================================================
+    juce::Optional<PositionInfo> getPosition() const override
+    {
+        PositionInfo info;
+        info.setIsPlaying(isPlaying);
+        info.setIsLooping(isLooping);
+
+        if (fields.bpm)
+            info.setBpm(bpm);
+        if (fields.timeSignature)
+            info.setTimeSignature(TimeSignature { numerator, denominator });
+        if (fields.timeInSamples)
+            info.setTimeInSamples(hostTimeInSamples + reportedJitter);
+        if (fields.timeInSeconds)
+            info.setTimeInSeconds(static_cast<double>(hostTimeInSamples) / sampleRate);
+        if (fields.ppqPosition)
+            info.setPpqPosition(ppqPos);
+        if (fields.ppqPositionOfLastBarStart)
+            info.setPpqPositionOfLastBarStart(getLastBarStart());
+        if (fields.loopPoints && isLooping)
+            info.setLoopPoints(LoopPoints { loopStart, loopEnd });
+
+        return info;
+    }
+
+    // moves the transport forward by numSamples samples (call after each processBlock)
+    void advance (int numSamples)
+    {
+        for (auto i = 0; i < numSamples; i++)
+            advanceOneSample();
+
+        applyEvents();
+
+        if (jitter > 0)
+            reportedJitter = std::uniform_int_distribution<int> (-jitter, jitter) (random);
+    }
+
+    int64_t getSessionSample() const                            { return sessionSample; }
+    bool isTransportPlaying() const                             { return isPlaying; }
+    const std::vector<double>& getIdealTicks() const            { return idealTicks; }
+    const std::vector<PlayingSegment>& getPlayingSegments() const { return segments; }
+
+    // closes the current playing segment, call at the end of the simulation
+    void finish() {
+        if (isPlaying)
+            closeSegment();
+    }
+
+private:
+    //==============================================================================
+    struct Event {
+        enum Type { play, stop, locate, tempo, rampStart, timeSignature };
+
+        int64_t sample;
+        Type type;
+        double value1;
+        double value2;
+    };
+
+    void addEvent (int64_t sample, Event::Type type, double value1 = 0.0, double value2 = 0.0) {
+        Event e { sample, type, value1, value2 };
+        events.insert(std::upper_bound(events.begin(), events.end(), e, [] (const Event& a, const Event& b) { return a.sample < b.sample; }), e);
+        applyEvents(); // if it is for the current sample
+    }
+
+    double getLastBarStart() const {
+        auto barLength = 4.0 * numerator / denominator;
+        return timeSigStartPpq + floor((ppqPos - timeSigStartPpq) / barLength) * barLength;
+    }
+
+    void openSegment (bool fromStop) {
+        segments.push_back({ sessionSample, sessionSample, fromStop });
+        segmentOpen = true;
+    }
+
+    void closeSegment() {
+        if (segmentOpen)
+            segments.back().endSample = sessionSample;
+        segmentOpen = false;
+    }
+
+    void applyEvents()
+    {
+        while (nextEvent < events.size() && events[nextEvent].sample <= sessionSample) {
+            const auto& e = events[nextEvent++];
+
+            switch (e.type) {
+                case Event::play:
+                    if (!isPlaying) {
+                        isPlaying = true;
+                        openSegment(true);
+                        setAnchor();
+                    }
+                    break;
+
+                case Event::stop:
+                    if (isPlaying) {
+                        closeSegment();
+                        isPlaying = false;
+                    }
+                    break;
+
+                case Event::locate:
+                    ppqPos = e.value1;
+                    hostTimeInSamples = static_cast<int64_t>(ppqPos * 60.0 * sampleRate / bpm);
+                    setAnchor();
+                    if (isPlaying) {
+                        closeSegment();
+                        openSegment(false);
+                    }
+                    break;
+
+                case Event::tempo:
+                    bpm = e.value1;
+                    rampEndSample = -1;
+                    setAnchor();
+                    break;
+
+                case Event::rampStart:
+                    rampStartBpm = bpm;
+                    rampEndBpm = e.value1;
+                    rampStartSample = sessionSample;
+                    rampEndSample = static_cast<int64_t>(e.value2);
+                    break;
+
+                case Event::timeSignature:
+                    timeSigStartPpq = getLastBarStart();
+                    numerator = static_cast<int>(e.value1);
+                    denominator = static_cast<int>(e.value2);
+                    break;
+            }
+        }
+    }
+
+    void advanceOneSample()
+    {
+        if (rampEndSample > sessionSample) {
+            auto progress = static_cast<double>(sessionSample - rampStartSample) / static_cast<double>(rampEndSample - rampStartSample);
+            bpm = rampStartBpm + (rampEndBpm - rampStartBpm) * progress;
+        }
+
+        if (isPlaying) {
+            // at a constant tempo, the position is computed from the last tempo change, relocation or loop wrap instead of
+            // being accumulated sample after sample, so the simulated host does not drift itself during long sessions
+            auto dppq = bpm / (60.0 * sampleRate);
+            auto isRamping = rampEndSample > sessionSample;
+            auto nextPpqPos = isRamping ? ppqPos + dppq : anchorPpqPos + static_cast<double>(sessionSample + 1 - anchorSample) * dppq;
+
+            // ideal grid points in [ppqPos, nextPpqPos[, up to the loop end: past it they are the ones from the loop start
+            auto gridStep = (denominator == 8) ? 1.0 / 48.0 : 1.0 / 24.0;
+            auto isWrapping = isLooping && ppqPos < loopEnd && nextPpqPos >= loopEnd;
+            auto endPpqPos = isWrapping ? loopEnd : nextPpqPos;
+            for (auto k = ceil(ppqPos / gridStep); k * gridStep < endPpqPos; k += 1.0)
+                idealTicks.push_back(static_cast<double>(sessionSample) + (k * gridStep - ppqPos) / dppq);
+
+            if (isWrapping) {
+                auto wrapSample = static_cast<double>(sessionSample) + (loopEnd - ppqPos) / dppq;
+                for (auto k = ceil(loopStart / gridStep); k * gridStep < loopStart + (nextPpqPos - loopEnd); k += 1.0)
+                    idealTicks.push_back(wrapSample + (k * gridStep - loopStart) / dppq);
+            }
+
+            ppqPos = nextPpqPos;
+            hostTimeInSamples++;
+
+            if (isLooping && ppqPos >= loopEnd) {
+                ppqPos = loopStart + (ppqPos - loopEnd);
+                hostTimeInSamples = static_cast<int64_t>(loopStart * 60.0 * sampleRate / bpm);
+                sessionSample++;
+                setAnchor();
+                closeSegment();
+                openSegment(false);
+                return;
+            }
+
+            if (isRamping) {
+                sessionSample++;
+                setAnchor();
+                return;
+            }
+        }
+
+        sessionSample++;
+    }
+
+    void setAnchor() {
+        anchorPpqPos = ppqPos;
+        anchorSample = sessionSample;
+    }
+
+    //==============================================================================
+    double sampleRate;
+
+    std::vector<Event> events;
+    size_t nextEvent = 0;
+
+    int64_t sessionSample = 0;
+    int64_t hostTimeInSamples = 0;
+    bool isPlaying = false;
+    double ppqPos = 0.0;
+    double bpm = 120.0;
+    double anchorPpqPos = 0.0; // ppqPos at anchorSample, the position moving from there at the current tempo
+    int64_t anchorSample = 0;
+
+    double rampStartBpm = 120.0, rampEndBpm = 120.0;
+    int64_t rampStartSample = 0, rampEndSample = -1;
+
+    int numerator = 4, denominator = 4;
+    double timeSigStartPpq = 0.0;
+
+    bool isLooping = false;
+    double loopStart = 0.0, loopEnd = 0.0;
+
+    int jitter = 0;
+    int reportedJitter = 0;
+    std::mt19937 random;
+
+    std::vector<double> idealTicks;
+    std::vector<PlayingSegment> segments;
+    bool segmentOpen = false;
+};
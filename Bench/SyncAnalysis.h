@@ -0,0 +1,194 @@
+/*
+    ==============================================================================
+
+    This file is part of the Midronome plugin, a VST3/AU/AAX plugin for Digital
+    Audio Workstations (DAW) whose purpose is to synchronize DAWs with the
+    Midronome (more info on <https://www.midronome.com/>).
+
+    Copyright © 2023 - Simon Lasnier (Midronome ApS)
+
+    The Midronome plugin is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option) any
+    later version.
+
+    The Midronome plugin is distributed in the hope that it will be useful, but
+    WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+    details.
+
+    You should have received a copy of the GNU General Public License along with
+    the Midronome plugin. If not, see <https://www.gnu.org/licenses/>.
+
+    ==============================================================================
+*/
+
+#pragma once
+
+#include "SimulatedPlayHead.h"
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+//==============================================================================
+/**
+    Finds the pulses in the plugin's output, at sub-sample precision: the edge of
+    a pulse is where its attack ramp crosses half of the pulse height, like the
+    Midronome input comparator would see it.
+*/
+class PulseDetector
+{
+public:
+    // half of the pulse height (the default of the pulseHeight parameter in PluginProcessor.cpp)
+    static constexpr float threshold = 0.45f;
+
+    // the attack ramp crosses the threshold 1 sample after the tick sample, or exactly
+    // 2 samples after the tick with MidronomeAudioProcessor::setSubSampleTicks()
+    explicit PulseDetector (double delay = 1.0) : edgeDelay (delay) {}
+
+    void process (const float* data, int numSamples)
+    {
+        for (auto i = 0; i < numSamples; i++) {
+            auto sample = data[i];
+
+            if (!isHigh && sample >= threshold) {
+                auto fraction = (sample > previous) ? static_cast<double>(threshold - previous) / static_cast<double>(sample - previous) : 1.0;
+                edges.push_back(static_cast<double>(position + i - 1) + fraction - edgeDelay);
+                isHigh = true;
+            }
+            else if (isHigh && sample < threshold) {
+                isHigh = false;
+            }
+
+            previous = sample;
+        }
+
+        position += numSamples;
+    }
+
+    const std::vector<double>& getEdges() const { return edges; }
+
+private:
+    double edgeDelay;
+    std::vector<double> edges; // in session samples
+    int64_t position = 0;
+    float previous = 0.0f;
+    bool isHigh = false;
+};
+
+
+//==============================================================================
+struct SyncReport {
+    int numIdealTicks = 0;
+    int numPulses = 0;
+    int numMatched = 0;
+    int numDropped = 0;     // ideal ticks with no pulse, once the sync has started
+    int numDuplicates = 0;  // pulses matching a tick which already had one, or no tick at all
+    int numStartDuplicates = 0; // the duplicates sent while catching up with the grid after a start (see analyseSync)
+
+    // timing errors of the matched pulses, in samples (pulse edge - ideal tick)
+    double meanError = 0.0;
+    double p99AbsError = 0.0;
+    double maxAbsError = 0.0;
+    double p99Jitter = 0.0; // p99 of the deviation from the mean error, i.e. without the constant latency
+
+    double toMicroseconds (double samples, double sampleRate) const { return samples * 1.0e6 / sampleRate; }
+};
+
+//==============================================================================
+/**
+    Matches each pulse edge to the nearest tick of the ideal grid (within half
+    the distance to the neighbouring ticks). Dropped ticks are only counted in
+    each playing segment after its first pulse: the plugin waits for the start of
+    a bar before sending its first tick after the transport starts.
+
+    With the lookahead, the ticks due before a start are sent at once from its
+    first sample, closer than the grid, until the pulses land on the grid: the
+    duplicates among them are counted in numStartDuplicates too.
+*/
+inline SyncReport analyseSync (const std::vector<double>& idealTicks, const std::vector<double>& pulses,
+                               const std::vector<SimulatedPlayHead::PlayingSegment>& segments)
+{
+    SyncReport report;
+    report.numIdealTicks = static_cast<int>(idealTicks.size());
+    report.numPulses = static_cast<int>(pulses.size());
+
+    std::vector<int> matchCount (idealTicks.size(), 0);
+    std::vector<double> errors, absErrors;
+    std::vector<double> pulseErrors (pulses.size(), std::numeric_limits<double>::infinity()); // infinite for duplicates
+    double errorSum = 0.0;
+
+    for (size_t p = 0; p < pulses.size(); p++) {
+        auto pulse = pulses[p];
+        auto next = std::lower_bound(idealTicks.begin(), idealTicks.end(), pulse);
+        auto best = idealTicks.end();
+
+        if (next != idealTicks.end())
+            best = next;
+        if (next != idealTicks.begin() && (best == idealTicks.end() || pulse - *(next - 1) < *best - pulse))
+            best = next - 1;
+
+        if (best == idealTicks.end()) {
+            report.numDuplicates++;
+            continue;
+        }
+
+        // half the distance to the neighbouring ticks
+        auto index = static_cast<size_t>(best - idealTicks.begin());
+        auto tolerance = 1.0e9;
+        if (index > 0)
+            tolerance = std::min(tolerance, (idealTicks[index] - idealTicks[index - 1]) / 2.0);
+        if (index + 1 < idealTicks.size())
+            tolerance = std::min(tolerance, (idealTicks[index + 1] - idealTicks[index]) / 2.0);
+
+        auto error = pulse - *best;
+        if (std::abs(error) > tolerance || matchCount[index]++ > 0) {
+            report.numDuplicates++;
+            continue;
+        }
+
+        report.numMatched++;
+        pulseErrors[p] = error;
+        errorSum += error;
+        errors.push_back(error);
+        absErrors.push_back(std::abs(error));
+    }
+
+    for (const auto& segment : segments) {
+        auto firstPulse = std::lower_bound(pulses.begin(), pulses.end(), static_cast<double>(segment.startSample));
+        if (firstPulse == pulses.end() || *firstPulse >= static_cast<double>(segment.endSample))
+            continue;
+
+        // after a relocation or a loop wrap the sync must continue, so every tick is expected
+        auto from = segment.startsFromStop ? *firstPulse - 1.0 : static_cast<double>(segment.startSample);
+
+        for (size_t i = 0; i < idealTicks.size(); i++)
+            if (idealTicks[i] > from && idealTicks[i] < static_cast<double>(segment.endSample) - 1.0 && matchCount[i] == 0)
+                report.numDropped++;
+
+        if (segment.startsFromStop) {
+            for (auto p = static_cast<size_t>(firstPulse - pulses.begin()); p < pulses.size() && pulses[p] < static_cast<double>(segment.endSample); p++) {
+                if (std::isinf(pulseErrors[p]))
+                    report.numStartDuplicates++;
+                else if (std::abs(pulseErrors[p]) < 2.0) // on the grid
+                    break;
+            }
+        }
+    }
+
+    if (!absErrors.empty()) {
+        std::sort(absErrors.begin(), absErrors.end());
+        report.meanError = errorSum / static_cast<double>(absErrors.size());
+        report.p99AbsError = absErrors[std::min(absErrors.size() - 1, static_cast<size_t>(0.99 * static_cast<double>(absErrors.size())))];
+        report.maxAbsError = absErrors.back();
+
+        std::vector<double> deviations;
+        for (auto error : errors)
+            deviations.push_back(std::abs(error - report.meanError));
+        std::sort(deviations.begin(), deviations.end());
+        report.p99Jitter = deviations[std::min(deviations.size() - 1, static_cast<size_t>(0.99 * static_cast<double>(deviations.size())))];
+    }
+
+    return report;
+}
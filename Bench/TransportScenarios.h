@@ -0,0 +1,146 @@
+/*
+    ==============================================================================
+
+    This file is part of the Midronome plugin, a VST3/AU/AAX plugin for Digital
+    Audio Workstations (DAW) whose purpose is to synchronize DAWs with the
+    Midronome (more info on <https://www.midronome.com/>).
+
+    Copyright © 2023 - Simon Lasnier (Midronome ApS)
+
+    The Midronome plugin is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option) any
+    later version.
+
+    The Midronome plugin is distributed in the hope that it will be useful, but
+    WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+    details.
+
+    You should have received a copy of the GNU General Public License along with
+    the Midronome plugin. If not, see <https://www.gnu.org/licenses/>.
+
+    ==============================================================================
+*/
+
+#pragma once
+
+#include "SimulatedPlayHead.h"
+
+#include <functional>
+#include <vector>
+
+//==============================================================================
+// a scripted transport behaviour, run for durationSeconds
+struct TransportScenario {
+    const char* name;
+    double durationSeconds;
+    std::function<void (SimulatedPlayHead&, double sampleRate)> script;
+};
+
+inline std::vector<TransportScenario> getTransportScenarios()
+{
+    auto s = [] (double seconds, double sampleRate) { return static_cast<int64_t>(seconds * sampleRate); };
+
+    return {
+        { "steady 120bpm 4/4", 60.0, [] (SimulatedPlayHead& p, double) {
+            p.setTempoAt(0, 120.0);
+            p.playAt(0);
+        }},
+
+        { "steady 97.3bpm 7/8", 60.0, [] (SimulatedPlayHead& p, double) {
+            p.setTempoAt(0, 97.3);
+            p.setTimeSignatureAt(0, 7, 8);
+            p.playAt(0);
+        }},
+
+        { "pre-roll from -4ppq", 30.0, [] (SimulatedPlayHead& p, double) {
+            p.setTempoAt(0, 128.0);
+            p.locateAt(0, -4.0);
+            p.playAt(0);
+        }},
+
+        { "2 bars loop", 120.0, [] (SimulatedPlayHead& p, double) {
+            p.setTempoAt(0, 120.0);
+            p.setLoop(8.0, 16.0);
+            p.locateAt(0, 8.0);
+            p.playAt(0);
+        }},
+
+        { "odd loop 5.5ppq", 120.0, [] (SimulatedPlayHead& p, double) {
+            p.setTempoAt(0, 133.0);
+            p.setLoop(2.0, 7.5);
+            p.playAt(0);
+        }},
+
+        { "off-grid loop, 5min", 300.0, [] (SimulatedPlayHead& p, double) {
+            // a loop set in samples or seconds rather than on the grid: the ticks after the seam are not the
+            // continuation of the ones before it
+            p.setTempoAt(0, 124.0);
+            p.setLoop(4.0, 9.937);
+            p.playAt(0);
+        }},
+
+        { "off-grid loop 7/8", 120.0, [] (SimulatedPlayHead& p, double) {
+            p.setTempoAt(0, 101.0);
+            p.setTimeSignatureAt(0, 7, 8);
+            p.setLoop(3.51, 10.0);
+            p.locateAt(0, 3.5);
+            p.playAt(0);
+        }},
+
+        { "accelerando 90->150bpm", 60.0, [=] (SimulatedPlayHead& p, double sr) {
+            p.setTempoAt(0, 90.0);
+            p.rampTempo(s(10.0, sr), s(50.0, sr), 150.0);
+            p.playAt(0);
+        }},
+
+        { "ritardando 160->70bpm", 60.0, [=] (SimulatedPlayHead& p, double sr) {
+            p.setTempoAt(0, 160.0);
+            p.rampTempo(s(10.0, sr), s(50.0, sr), 70.0);
+            p.playAt(0);
+        }},
+
+        { "fast ramps 100<->180bpm", 60.0, [=] (SimulatedPlayHead& p, double sr) {
+            // back and forth in 3s, with 2s of constant tempo in between
+            p.setTempoAt(0, 100.0);
+            p.playAt(0);
+            for (auto t = 2.0; t < 55.0; t += 10.0) {
+                p.rampTempo(s(t, sr), s(t + 3.0, sr), 180.0);
+                p.rampTempo(s(t + 5.0, sr), s(t + 8.0, sr), 100.0);
+            }
+        }},
+
+        { "time sig changes", 60.0, [=] (SimulatedPlayHead& p, double sr) {
+            // changes on bar starts: 8 bars of 4/4 (16s), 8 bars of 7/8 (14s), then 3/4
+            p.setTempoAt(0, 120.0);
+            p.playAt(0);
+            p.setTimeSignatureAt(s(16.0, sr), 7, 8);
+            p.setTimeSignatureAt(s(30.0, sr), 3, 4);
+        }},
+
+        { "stop/start", 60.0, [=] (SimulatedPlayHead& p, double sr) {
+            p.setTempoAt(0, 110.0);
+            for (auto t = 0.0; t < 60.0; t += 10.0) {
+                p.playAt(s(t, sr));
+                p.stopAt(s(t + 7.3, sr));
+            }
+        }},
+
+        { "jittery timeInSamples", 60.0, [] (SimulatedPlayHead& p, double) {
+            p.setTempoAt(0, 120.0);
+            p.setTimeInSamplesJitter(4, 1234);
+            p.playAt(0);
+        }},
+
+        { "missing optional fields", 60.0, [] (SimulatedPlayHead& p, double) {
+            p.fields.timeInSamples = false;
+            p.fields.timeInSeconds = false;
+            p.fields.ppqPositionOfLastBarStart = false;
+            p.fields.loopPoints = false;
+            p.setTempoAt(0, 120.0);
+            p.locateAt(0, 2.0);
+            p.playAt(0);
+        }},
+    };
+}
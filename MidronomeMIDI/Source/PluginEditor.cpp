@@ -25,11 +25,20 @@
 
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "BinaryData.h" // JuceHeader.h of the Projucer includes it, not the one of juce_generate_juce_header
 
 //==============================================================================
 MidronomeAudioProcessorEditor::MidronomeAudioProcessorEditor (MidronomeAudioProcessor& p)
-    : AudioProcessorEditor (&p), audioProcessor (p)
+    : AudioProcessorEditor (&p), audioProcessor (p), settingsView (p)
 {
+    settingsButton.setClickingTogglesState(true);
+    settingsButton.onClick = [this] {
+        settingsView.setVisible(settingsButton.getToggleState());
+        repaint();
+    };
+    addAndMakeVisible(settingsButton);
+    addChildComponent(settingsView);
+    
     setSize (300, 250);
 }
 
@@ -42,9 +51,19 @@ void MidronomeAudioProcessorEditor::paint (juce::Graphics& g)
 {
     auto myImg = juce::ImageCache::getFromMemory(BinaryData::midrologo_midi_png, BinaryData::midrologo_midi_pngSize);
     g.fillAll(juce::Colours::black);
-    g.drawImageAt(myImg, 78, 71);
+    
+    if (!settingsView.isVisible())
+        g.drawImageAt(myImg, 78, 71);
 }
 
 void MidronomeAudioProcessorEditor::resized()
 {
+    settingsView.setBounds(getLocalBounds().withTrimmedBottom(30));
+    settingsButton.setBounds(getWidth() - 66, getHeight() - 24, 60, 18);
+}
+
+//==============================================================================
+juce::AudioProcessorEditor* createMidronomeEditor (MidronomeAudioProcessor& p)
+{
+    return new MidronomeAudioProcessorEditor (p);
 }
@@ -41,6 +41,10 @@ public:
 
 private:
     MidronomeAudioProcessor& audioProcessor;
+    
+    // settings view, the parameters of the processor (see createParameterLayout) in place of the logo
+    juce::TextButton settingsButton { "Settings" };
+    juce::GenericAudioProcessorEditor settingsView;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidronomeAudioProcessorEditor)
 };
@@ -25,69 +25,6 @@
 
 #pragma once
 
-#include <JuceHeader.h>
-
-
-//==============================================================================
-/**
-*/
-class MidronomeAudioProcessor  : public juce::AudioProcessor
-                            #if JucePlugin_Enable_ARA
-                             , public juce::AudioProcessorARAExtension
-                            #endif
-{
-public:
-    //==============================================================================
-    MidronomeAudioProcessor();
-    ~MidronomeAudioProcessor() override;
-
-    //==============================================================================
-    void prepareToPlay (double sr, int samplesPerBlock) override;
-    void releaseResources() override;
-
-   #ifndef JucePlugin_PreferredChannelConfigurations
-    bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
-   #endif
-
-    void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
-
-    //==============================================================================
-    juce::AudioProcessorEditor* createEditor() override;
-    bool hasEditor() const override;
-
-    //==============================================================================
-    const juce::String getName() const override;
-
-    bool acceptsMidi() const override;
-    bool producesMidi() const override;
-    bool isMidiEffect() const override;
-    double getTailLengthSeconds() const override;
-
-    //==============================================================================
-    int getNumPrograms() override;
-    int getCurrentProgram() override;
-    void setCurrentProgram (int index) override;
-    const juce::String getProgramName (int index) override;
-    void changeProgramName (int index, const juce::String& newName) override;
-
-    //==============================================================================
-    void getStateInformation (juce::MemoryBlock& destData) override;
-    void setStateInformation (const void* data, int sizeInBytes) override;
-
-private:
-    //==============================================================================
-    double sampleRate;
-    
-    typedef enum values_type {
-        BPM,
-        BEATS_PER_BAR
-    } values_type_t;
-    
-    void sendMidiToHost(values_type_t v, int newValue, int totalNumSamples, bool isPlaying, juce::MidiBuffer& midiMessages);
-    
-    int lastValueSent[2];
-    int waitBeforeSending[2];
-    
-    
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidronomeAudioProcessor)
-};
+// MidronomeMIDI shares the processor of the Midronome plugin: built as a MIDI effect, it only compiles its MIDI
+// messages (see SyncOutputs.h). This folder only has its own editor.
+#include "../../Source/PluginProcessor.h"
@@ -0,0 +1,169 @@
+/*
+    ==============================================================================
+
+    This file is part of the Midronome plugin, a VST3/AU/AAX plugin for Digital
+    Audio Workstations (DAW) whose purpose is to synchronize DAWs with the
+    Midronome (more info on <https://www.midronome.com/>).
+
+    Copyright © 2023 - Simon Lasnier (Midronome ApS)
+
+    The Midronome plugin is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option) any
+    later version.
+
+    The Midronome plugin is distributed in the hope that it will be useful, but
+    WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+    details.
+
+    You should have received a copy of the GNU General Public License along with
+    the Midronome plugin. If not, see <https://www.gnu.org/licenses/>.
+
+    ==============================================================================
+*/
+
+#include "LtcEncoder.h"
+
+//==============================================================================
+void LtcEncoder::prepare(double sr, FrameRate rate)
+{
+    sampleRate = sr;
+    setFrameRate(rate);
+}
+
+void LtcEncoder::setFrameRate(FrameRate rate) noexcept MIDRONOME_NONBLOCKING
+{
+    frameRate = rate;
+    framesPerSample = getFramesPerSecond(frameRate) / sampleRate;
+    halfBitsPerSample = 2.0 * bitsPerFrame * framesPerSample; // < 1 up to 30fps at 44.1kHz, so there is at most one edge per sample
+    isRunning = false;
+}
+
+double LtcEncoder::getFramesPerSecond(FrameRate rate) noexcept
+{
+    switch (rate) {
+        case FrameRate::fps24:          return 24.0;
+        case FrameRate::fps25:          return 25.0;
+        case FrameRate::fps2997drop:    return 30000.0 / 1001.0;
+        case FrameRate::fps30:          return 30.0;
+    }
+
+    return 25.0;
+}
+
+
+//==============================================================================
+template <typename SampleType>
+void LtcEncoder::render(int64_t timeInSamples, SampleType* dest, int numSamples) noexcept MIDRONOME_NONBLOCKING
+{
+    if (!isRunning || std::abs(timeInSamples - expectedTimeInSamples) > 2) { // start, or the playhead moved: jump to the host time
+        auto framePos = (static_cast<double>(timeInSamples) - 0.5) * framesPerSample; // each sample is the average over its half samples around it
+        auto newFrameNo = static_cast<int64_t>(std::floor(framePos));
+        halfBitPos = juce::jlimit(0.0, 2.0 * bitsPerFrame - 1.0e-9, (framePos - static_cast<double>(newFrameNo)) * 2.0 * bitsPerFrame);
+        startFrame(newFrameNo);
+        isRunning = true;
+    }
+
+    expectedTimeInSamples = timeInSamples + numSamples;
+
+    for (auto i = 0; i < numSamples; i++) {
+        auto halfBit = static_cast<int>(halfBitPos);
+        auto nextPos = halfBitPos + halfBitsPerSample;
+
+        if (static_cast<int>(nextPos) == halfBit) {
+            dest[i] = static_cast<SampleType>(halfBitLevels[static_cast<size_t>(halfBit)]);
+        }
+        else { // an edge in this sample, at nextPos's half bit start
+            auto before = halfBitLevels[static_cast<size_t>(halfBit)];
+            auto fractionBefore = (static_cast<double>(halfBit + 1) - halfBitPos) / halfBitsPerSample;
+
+            if (nextPos >= 2.0 * bitsPerFrame) {
+                startFrame(frameNo + 1);
+                nextPos -= 2.0 * bitsPerFrame;
+                halfBit = -1;
+            }
+
+            auto after = halfBitLevels[static_cast<size_t>(halfBit + 1)];
+            dest[i] = static_cast<SampleType>(fractionBefore * before + (1.0 - fractionBefore) * after);
+        }
+
+        halfBitPos = nextPos;
+    }
+}
+
+template void LtcEncoder::render<float>(int64_t, float*, int) noexcept MIDRONOME_NONBLOCKING;
+template void LtcEncoder::render<double>(int64_t, double*, int) noexcept MIDRONOME_NONBLOCKING;
+
+
+//==============================================================================
+// biphase mark: the level changes at the start of every bit, and in its middle for a 1
+// the polarity bit of the word makes its number of changes even, so every frame starts from the same level
+void LtcEncoder::startFrame(int64_t newFrameNo) noexcept
+{
+    frameNo = newFrameNo;
+
+    uint8_t bytes[bitsPerFrame / 8];
+    getFrameWord(frameNo, frameRate, bytes);
+
+    auto currentLevel = -level;
+    for (auto bit = 0; bit < bitsPerFrame; bit++) {
+        currentLevel = -currentLevel;
+        halfBitLevels[static_cast<size_t>(2*bit)] = currentLevel;
+
+        if ((bytes[bit / 8] >> (bit % 8)) & 1)
+            currentLevel = -currentLevel;
+        halfBitLevels[static_cast<size_t>(2*bit + 1)] = currentLevel;
+    }
+}
+
+
+//==============================================================================
+void LtcEncoder::getFrameWord(int64_t frameNo, FrameRate rate, uint8_t (&bytes)[bitsPerFrame / 8]) noexcept
+{
+    auto framesPerSecond = (rate == FrameRate::fps24) ? 24 : (rate == FrameRate::fps25) ? 25 : 30;
+    auto isDropFrame = (rate == FrameRate::fps2997drop);
+
+    auto framesPerDay = isDropFrame ? static_cast<int64_t>(24*6*17982) : static_cast<int64_t>(framesPerSecond*86400);
+    frameNo = ((frameNo % framesPerDay) + framesPerDay) % framesPerDay; // the timecode wraps after 23:59:59, and before 00:00:00
+
+    if (isDropFrame) { // frames 0 and 1 are skipped every minute, except every 10 minutes (17982 frames)
+        auto tenMinutes = frameNo / 17982;
+        auto remainder = frameNo % 17982;
+        frameNo += 18*tenMinutes + (remainder > 1 ? 2*((remainder - 2) / 1798) : 0);
+    }
+
+    auto frames = static_cast<int>(frameNo % framesPerSecond);
+    auto seconds = static_cast<int>((frameNo / framesPerSecond) % 60);
+    auto minutes = static_cast<int>((frameNo / (framesPerSecond * 60)) % 60);
+    auto hours = static_cast<int>((frameNo / (framesPerSecond * 3600)) % 24);
+
+    for (auto& byte : bytes)
+        byte = 0;
+
+    auto setBits = [&bytes] (int firstBit, int numBits, int value) {
+        for (auto i = 0; i < numBits; i++)
+            if ((value >> i) & 1)
+                bytes[(firstBit + i) / 8] |= static_cast<uint8_t>(1 << ((firstBit + i) % 8));
+    };
+
+    // the user bits (4-7, 12-15...) and binary group flags stay at 0
+    setBits(0, 4, frames % 10);
+    setBits(8, 2, frames / 10);
+    setBits(10, 1, isDropFrame ? 1 : 0);
+    setBits(16, 4, seconds % 10);
+    setBits(24, 3, seconds / 10);
+    setBits(32, 4, minutes % 10);
+    setBits(40, 3, minutes / 10);
+    setBits(48, 4, hours % 10);
+    setBits(56, 2, hours / 10);
+    setBits(64, 16, 0xBFFC); // sync word 0011 1111 1111 1101 in transmission order (bit 64 first)
+
+    // polarity correction bit (bit 59 at 25fps), set so the word has an even number of zeros
+    auto numOnes = 0;
+    for (auto byte : bytes)
+        for (auto i = 0; i < 8; i++)
+            numOnes += (byte >> i) & 1;
+    if (numOnes % 2 != 0)
+        setBits(rate == FrameRate::fps25 ? 59 : 27, 1, 1);
+}
@@ -0,0 +1,89 @@
+/*
+    ==============================================================================
+
+    This file is part of the Midronome plugin, a VST3/AU/AAX plugin for Digital
+    Audio Workstations (DAW) whose purpose is to synchronize DAWs with the
+    Midronome (more info on <https://www.midronome.com/>).
+
+    Copyright © 2023 - Simon Lasnier (Midronome ApS)
+
+    The Midronome plugin is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option) any
+    later version.
+
+    The Midronome plugin is distributed in the hope that it will be useful, but
+    WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+    details.
+
+    You should have received a copy of the GNU General Public License along with
+    the Midronome plugin. If not, see <https://www.gnu.org/licenses/>.
+
+    ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "Nonblocking.h"
+
+#include <array>
+
+//==============================================================================
+/**
+    SMPTE linear timecode (LTC) encoder: renders the biphase mark signal of the
+    timecode of the host time, 00:00:00:00 being the start of the session.
+
+    Each 80 bits frame word is computed once when its frame starts, and expanded
+    into the levels of its 160 half bits, so the work per sample is a walk in
+    that table. The edges are placed at their exact (sub-sample) position: the
+    sample containing an edge gets the average of the levels on both sides.
+*/
+class LtcEncoder
+{
+public:
+    enum class FrameRate { fps24, fps25, fps2997drop, fps30 };
+
+    static constexpr int bitsPerFrame = 80;
+    static constexpr float level = 0.5f; // about -6dBFS peak, LTC inputs expect line level
+
+    // message thread, before rendering
+    void prepare(double sampleRate, FrameRate frameRate);
+
+    // audio thread: the frame rate changed, the next render starts from the host time again at the new rate
+    void setFrameRate(FrameRate newFrameRate) noexcept MIDRONOME_NONBLOCKING;
+    FrameRate getFrameRate() const { return frameRate; }
+
+    //==============================================================================
+    // audio thread: renders numSamples samples from the host time timeInSamples (>= 0) - following blocks continue
+    // the current frame if the host time follows, otherwise the encoder jumps to the frame of the new time
+    template <typename SampleType>
+    void render(int64_t timeInSamples, SampleType* dest, int numSamples) noexcept MIDRONOME_NONBLOCKING;
+
+    // audio thread: the transport stopped, the next render starts from the host time again
+    void reset() noexcept MIDRONOME_NONBLOCKING { isRunning = false; }
+
+    //==============================================================================
+    // the frame word of frame number frameNo (counted from 00:00:00:00), bit n of the word being bit n % 8 of
+    // bytes[n / 8] - with drop frame, the frame numbers are converted to the labels which skip frames 0 and 1
+    static void getFrameWord(int64_t frameNo, FrameRate frameRate, uint8_t (&bytes)[bitsPerFrame / 8]) noexcept;
+
+    static double getFramesPerSecond(FrameRate frameRate) noexcept;
+
+private:
+    //==============================================================================
+    void startFrame(int64_t newFrameNo) noexcept;
+
+    FrameRate frameRate = FrameRate::fps25;
+    double sampleRate = 48000.0;
+    double halfBitsPerSample = 0.0;
+    double framesPerSample = 0.0;
+
+    int64_t frameNo = 0;
+    double halfBitPos = 0.0; // position in the current frame, in half bits (0 to 2*bitsPerFrame)
+    int64_t expectedTimeInSamples = 0;
+    bool isRunning = false;
+
+    std::array<float, 2*bitsPerFrame> halfBitLevels {}; // the current frame, as rendered
+};
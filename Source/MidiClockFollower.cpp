@@ -0,0 +1,170 @@
+/*
+    ==============================================================================
+
+    This file is part of the Midronome plugin, a VST3/AU/AAX plugin for Digital
+    Audio Workstations (DAW) whose purpose is to synchronize DAWs with the
+    Midronome (more info on <https://www.midronome.com/>).
+
+    Copyright © 2023 - Simon Lasnier (Midronome ApS)
+
+    The Midronome plugin is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option) any
+    later version.
+
+    The Midronome plugin is distributed in the hope that it will be useful, but
+    WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+    details.
+
+    You should have received a copy of the GNU General Public License along with
+    the Midronome plugin. If not, see <https://www.gnu.org/licenses/>.
+
+    ==============================================================================
+*/
+
+
+#include "MidiClockFollower.h"
+
+//==============================================================================
+void MidiClockFollower::prepare(double sr)
+{
+    sampleRate = sr;
+    blockStartSample = 0;
+    reset();
+}
+
+void MidiClockFollower::reset() noexcept MIDRONOME_NONBLOCKING
+{
+    numClocks = 0;
+    lockSample = -1;
+    isRunning = false;
+    lastClockNo = -1;
+    relocationSample = blockStartSample;
+    startClockTime = -1.0;
+    wasPlaying = false;
+    startLateSamples = 0;
+}
+
+
+//==============================================================================
+juce::AudioPlayHead::PositionInfo MidiClockFollower::process(juce::MidiBuffer& midiMessages, int numSamples,
+                                                             const juce::Optional<juce::AudioPlayHead::PositionInfo>& hostInfo) noexcept MIDRONOME_NONBLOCKING
+{
+    MIDRONOME_BEGIN_UNCHECKED_CALLS // the MidiBuffer iterators only walk its data, and clear() keeps its memory
+    for (const auto metadata : midiMessages) {
+        auto sample = blockStartSample + metadata.samplePosition;
+        
+        switch (metadata.data[0]) {
+            case 0xf8: // clock
+                clockReceived(static_cast<double>(sample));
+                break;
+            case 0xfa: // start: the next clock is the start of the song
+                isRunning = true;
+                relocated(-1, sample);
+                break;
+            case 0xfb: // continue: from the next clock
+                isRunning = true;
+                relocationSample = sample;
+                startClockTime = -1.0;
+                break;
+            case 0xfc: // stop
+                isRunning = false;
+                break;
+            case 0xf2: // song position pointer, in 16th notes (6 clocks)
+                if (metadata.numBytes >= 3)
+                    relocated(static_cast<int64_t>(metadata.data[1] | (metadata.data[2] << 7)) * 6 - 1, sample);
+                break;
+            default:
+                break;
+        }
+    }
+    
+    midiMessages.clear(); // keeps its memory
+    MIDRONOME_END_UNCHECKED_CALLS
+    
+    auto blockEndSample = blockStartSample + numSamples;
+    if (hasTempo() && static_cast<double>(blockEndSample) - lastReceivedTime > 4.0*period) // the clock stopped
+        numClocks = 0;
+    
+    juce::AudioPlayHead::PositionInfo info;
+    if (hostInfo.hasValue())
+        info.setTimeSignature(hostInfo->getTimeSignature());
+    
+    // the transport starts playing once the tempo is known, which can be after the first clock following Start
+    auto isPlaying = isRunning && hasTempo();
+    startLateSamples = isPlaying && !wasPlaying && startClockTime >= 0.0
+                       ? std::max(int64_t { 0 }, blockStartSample - static_cast<int64_t>(startClockTime)) : 0;
+    wasPlaying = isPlaying;
+    
+    info.setIsPlaying(isPlaying);
+    info.setTimeInSamples(blockStartSample - relocationSample); // only continuous between 2 relocations, like a host time
+    info.setTimeInSeconds(static_cast<double>(blockStartSample - relocationSample) / sampleRate);
+    
+    if (hasTempo()) {
+        auto ppqPos = (static_cast<double>(lastClockNo) + (static_cast<double>(blockStartSample) - lastClockTime) / period) / 24.0;
+        auto timeSig = info.getTimeSignature();
+        auto barLength = timeSig.hasValue() ? 4.0 * timeSig->numerator / timeSig->denominator : 4.0; // in quarter notes, 3.5 in 7/8 - as the sync engine finds the bars
+        
+        info.setBpm(getBpm());
+        info.setPpqPosition(ppqPos);
+        info.setPpqPositionOfLastBarStart(std::floor(ppqPos / barLength) * barLength);
+    }
+    
+    blockStartSample = blockEndSample;
+    return info;
+}
+
+
+//==============================================================================
+// the loop: the k-th clock since it started corrects the predicted time of this clock and the period by its error,
+// with the gains of a least squares line fit of the k clocks (an exact fit for k = 2), which decrease as k grows
+// up to numLockInClocks, and then stay there (alpha ~0.08, beta ~0.0026: about 20 clocks of time constant)
+void MidiClockFollower::clockReceived(double time) noexcept
+{
+    if (numClocks >= 2) {
+        auto error = time - (lastClockTime + period);
+        
+        if (time - lastReceivedTime > 4.0*period) { // the clock stopped: this is a new one
+            numClocks = 0;
+        }
+        else if (std::abs(error) > 0.25*period) { // the tempo jumped: the loop starts again from the last clock
+            numClocks = 1;
+            lastClockTime = lastReceivedTime;
+            period = 0.0;
+        }
+    }
+    
+    if (numClocks == 0) {
+        lastClockTime = time;
+        period = 0.0;
+    }
+    else {
+        auto k = static_cast<double>(std::min(numClocks + 1, numLockInClocks));
+        auto alpha = 2.0*(2.0*k - 1.0) / (k*(k + 1.0));
+        auto beta = 6.0 / (k*(k + 1.0));
+        auto error = time - (lastClockTime + period);
+        
+        lastClockTime += period + alpha*error;
+        period += beta*error;
+    }
+    
+    if (numClocks + 1 == numLockInClocks)
+        lockSample = static_cast<int64_t>(time);
+    
+    numClocks = std::min(numClocks + 1, numLockInClocks);
+    lastReceivedTime = time;
+    
+    if (isRunning) {
+        lastClockNo++;
+        if (startClockTime < 0.0)
+            startClockTime = time;
+    }
+}
+
+void MidiClockFollower::relocated(int64_t newLastClockNo, int64_t sample) noexcept
+{
+    lastClockNo = newLastClockNo;
+    relocationSample = sample;
+    startClockTime = -1.0;
+}
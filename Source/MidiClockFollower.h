@@ -0,0 +1,107 @@
+/*
+    ==============================================================================
+
+    This file is part of the Midronome plugin, a VST3/AU/AAX plugin for Digital
+    Audio Workstations (DAW) whose purpose is to synchronize DAWs with the
+    Midronome (more info on <https://www.midronome.com/>).
+
+    Copyright © 2023 - Simon Lasnier (Midronome ApS)
+
+    The Midronome plugin is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option) any
+    later version.
+
+    The Midronome plugin is distributed in the hope that it will be useful, but
+    WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+    details.
+
+    You should have received a copy of the GNU General Public License along with
+    the Midronome plugin. If not, see <https://www.gnu.org/licenses/>.
+
+    ==============================================================================
+*/
+
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "Nonblocking.h"
+
+//==============================================================================
+/**
+    Follows an incoming MIDI clock (24 clocks per quarter note) with Start,
+    Continue, Stop and Song Position Pointer, and gives the transport it
+    describes as a host playhead would, so the sync engine can run from it.
+
+    The clock messages are timestamped to the sample they arrive at, with the
+    jitter of the MIDI interface and of the host. A software PLL (an alpha-beta
+    loop on the clock times) estimates the clock period and the time of the
+    last clock: the transport it gives is clean, and the pulses regenerated
+    from it do not follow that jitter.
+
+    The gains of the loop start with those of a least squares fit of the clocks
+    received so far, and decrease down to the tracking bandwidth: the loop
+    locks on a new clock after exactly numLockInClocks clocks, whatever the
+    tempo, then filters the jitter. It starts again when the tempo jumps or the
+    clock stops.
+*/
+class MidiClockFollower
+{
+public:
+    static constexpr int numLockInClocks = 48; // 2 quarter notes
+
+    // message thread, before following
+    void prepare(double sampleRate);
+
+    // audio thread: forgets the clock and the transport, the loop locks again on the next clocks
+    void reset() noexcept MIDRONOME_NONBLOCKING;
+
+    //==============================================================================
+    // audio thread: follows the clock messages of a block (incoming MIDI is not passed through, midiMessages is
+    // cleared), and returns the transport at the start of the block - the time signature comes from hostInfo
+    // the block is read before the transport is computed, so a transport starting in the block starts on time
+    juce::AudioPlayHead::PositionInfo process(juce::MidiBuffer& midiMessages, int numSamples,
+                                              const juce::Optional<juce::AudioPlayHead::PositionInfo>& hostInfo) noexcept MIDRONOME_NONBLOCKING;
+
+    // the tempo is known from 2 clocks, locked after numLockInClocks
+    bool hasTempo() const noexcept { return numClocks >= 2; }
+    bool isLocked() const noexcept { return numClocks >= numLockInClocks; }
+    double getBpm() const noexcept { return hasTempo() ? 60.0 * sampleRate / (24.0 * period) : 0.0; }
+
+    // sample (counted from the first prepare) of the clock the loop locked on, or -1 if it is not locked
+    int64_t getLockSample() const noexcept { return isLocked() ? lockSample : -1; }
+    
+    // when the clock starts with Start (or Continue, or a Song Position Pointer), the tempo is only known from its 2nd clock:
+    // in the block the transport starts playing in, the samples since the first clock after Start, so the sync engine can
+    // still start on the bar of that clock, late - 0 in the other blocks, and when the tempo was known before that clock
+    int64_t getStartLateSamples() const noexcept { return startLateSamples; }
+
+private:
+    //==============================================================================
+    void clockReceived(double time) noexcept;
+    void relocated(int64_t newLastClockNo, int64_t sample) noexcept;
+
+    double sampleRate = 48000.0;
+    int64_t blockStartSample = 0; // samples followed since prepare()
+
+    // the loop: filtered time (in samples) and period of the clocks
+    double lastClockTime = 0.0;
+    double period = 0.0;
+    double lastReceivedTime = 0.0; // unfiltered, to detect when the clock stops
+    int numClocks = 0; // received since the loop (re)started, up to numLockInClocks
+    int64_t lockSample = -1;
+
+    // the transport: song position of the last clock in clocks (it only advances while running, -1 after Start so the
+    // next clock is the song start), and the sample of the last Start, Continue or Song Position Pointer
+    bool isRunning = false;
+    int64_t lastClockNo = -1;
+    int64_t relocationSample = 0;
+    
+    // the first clock after the last Start, Continue or Song Position Pointer (-1 until it comes), and how late the
+    // transport started playing after it
+    double startClockTime = -1.0;
+    bool wasPlaying = false;
+    int64_t startLateSamples = 0;
+};
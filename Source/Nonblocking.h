@@ -0,0 +1,42 @@
+/*
+    ==============================================================================
+
+    This file is part of the Midronome plugin, a VST3/AU/AAX plugin for Digital
+    Audio Workstations (DAW) whose purpose is to synchronize DAWs with the
+    Midronome (more info on <https://www.midronome.com/>).
+
+    Copyright © 2023 - Simon Lasnier (Midronome ApS)
+
+    The Midronome plugin is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option) any
+    later version.
+
+    The Midronome plugin is distributed in the hope that it will be useful, but
+    WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+    details.
+
+    You should have received a copy of the GNU General Public License along with
+    the Midronome plugin. If not, see <https://www.gnu.org/licenses/>.
+
+    ==============================================================================
+*/
+
+#pragma once
+
+// the audio path functions, which must never lock, allocate or make a blocking call: in the MIDRONOME_RTSAN build
+// (see CMakeLists.txt) Clang checks what they call, and its RealtimeSanitizer aborts if they do at run time
+//
+// Clang can only check the functions it sees the body of: the calls to virtual functions and to the JUCE functions
+// defined in its .cpp files are wrapped in MIDRONOME_BEGIN_UNCHECKED_CALLS / MIDRONOME_END_UNCHECKED_CALLS, each with
+// the reason it does not block, so -Wfunction-effects only warns about new calls - RTSan still checks them at run time
+#if MIDRONOME_RTSAN
+ #define MIDRONOME_NONBLOCKING [[clang::nonblocking]]
+ #define MIDRONOME_BEGIN_UNCHECKED_CALLS _Pragma ("clang diagnostic push") _Pragma ("clang diagnostic ignored \"-Wfunction-effects\"")
+ #define MIDRONOME_END_UNCHECKED_CALLS _Pragma ("clang diagnostic pop")
+#else
+ #define MIDRONOME_NONBLOCKING
+ #define MIDRONOME_BEGIN_UNCHECKED_CALLS
+ #define MIDRONOME_END_UNCHECKED_CALLS
+#endif
@@ -25,26 +25,142 @@
 
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "BinaryData.h" // JuceHeader.h of the Projucer includes it, not the one of juce_generate_juce_header
 
 //==============================================================================
 MidronomeAudioProcessorEditor::MidronomeAudioProcessorEditor (MidronomeAudioProcessor& p)
-    : AudioProcessorEditor (&p), audioProcessor (p)
+    : AudioProcessorEditor (&p), audioProcessor (p), settingsView (p)
 {
+    settingsButton.setClickingTogglesState(true);
+    settingsButton.onClick = [this] {
+        if (settingsButton.getToggleState())
+            diagnosticsButton.setToggleState(false, juce::sendNotification); // one view at a time
+        
+        settingsView.setVisible(settingsButton.getToggleState());
+        repaint();
+    };
+    addAndMakeVisible(settingsButton);
+    addChildComponent(settingsView);
+    
+    diagnosticsButton.setClickingTogglesState(true);
+    diagnosticsButton.onClick = [this] {
+        showDiagnostics = diagnosticsButton.getToggleState();
+        if (showDiagnostics)
+            settingsButton.setToggleState(false, juce::sendNotification);
+        
+        if (showDiagnostics) {
+            audioProcessor.getDiagnostics().viewOpened(); // the CPU time is measured from now on
+            previousDiagnostics = diagnostics = audioProcessor.getDiagnostics().getSnapshot();
+            tickRate = 0.0;
+            startTimerHz(4); // the audio thread never waits for us, we just read its atomics from time to time
+        }
+        else {
+            stopTimer();
+            audioProcessor.getDiagnostics().viewClosed();
+        }
+        
+        repaint();
+    };
+    addAndMakeVisible(diagnosticsButton);
+    
     setSize (300, 250);
 }
 
 MidronomeAudioProcessorEditor::~MidronomeAudioProcessorEditor()
 {
+    if (isTimerRunning())
+        audioProcessor.getDiagnostics().viewClosed();
+    
+    stopTimer();
 }
 
 //==============================================================================
 void MidronomeAudioProcessorEditor::paint (juce::Graphics& g)
 {
-    auto myImg = juce::ImageCache::getFromMemory(BinaryData::midrologo_png, BinaryData::midrologo_pngSize);
     g.fillAll(juce::Colours::black);
+    
+    if (settingsView.isVisible())
+        return;
+    
+    if (showDiagnostics) {
+        paintDiagnostics(g);
+        return;
+    }
+    
+    auto myImg = juce::ImageCache::getFromMemory(BinaryData::midrologo_png, BinaryData::midrologo_pngSize);
     g.drawImageAt(myImg, 86, 87);
 }
 
 void MidronomeAudioProcessorEditor::resized()
 {
+    settingsView.setBounds(getLocalBounds().withTrimmedBottom(30));
+    settingsButton.setBounds(getWidth() - 132, getHeight() - 24, 60, 18);
+    diagnosticsButton.setBounds(getWidth() - 66, getHeight() - 24, 60, 18);
+}
+
+//==============================================================================
+void MidronomeAudioProcessorEditor::timerCallback()
+{
+    previousDiagnostics = diagnostics;
+    diagnostics = audioProcessor.getDiagnostics().getSnapshot();
+    
+    // counted in audio samples, so it is also right when the host renders faster than real time
+    auto numSamples = diagnostics.numSamplesPlaying - previousDiagnostics.numSamplesPlaying;
+    if (diagnostics.numTicks < previousDiagnostics.numTicks || diagnostics.numSamplesPlaying < previousDiagnostics.numSamplesPlaying)
+        tickRate = 0.0; // reset by prepareToPlay
+    else if (numSamples > 0)
+        tickRate = static_cast<double>(diagnostics.numTicks - previousDiagnostics.numTicks) * diagnostics.sampleRate / static_cast<double>(numSamples);
+    else
+        tickRate = 0.0; // not playing
+    
+    repaint();
+}
+
+void MidronomeAudioProcessorEditor::paintDiagnostics (juce::Graphics& g)
+{
+    const auto& d = diagnostics;
+    auto blockSeconds = (d.sampleRate > 0.0) ? static_cast<double>(d.lastBlockNumSamples) / d.sampleRate : 0.0;
+    
+    g.setColour(juce::Colours::white);
+    g.setFont(13.0f);
+    
+    g.drawText("Tick rate: " + juce::String(tickRate, 1) + " /s (" + juce::String(tickRate * 60.0 / 24.0, 1) + " bpm)",
+               8, 6, getWidth() - 16, 16, juce::Justification::centredLeft);
+    g.drawText("Discontinuities: " + juce::String(static_cast<juce::int64>(d.numDiscontinuities))
+               + "   Ticks: " + juce::String(static_cast<juce::int64>(d.numTicks)),
+               8, 22, getWidth() - 16, 16, juce::Justification::centredLeft);
+    g.drawText("CPU: " + juce::String(d.lastBlockCpuSeconds * 1.0e6, 1) + " us/block (max " + juce::String(d.maxBlockCpuSeconds * 1.0e6, 1)
+               + " us), " + juce::String(blockSeconds > 0.0 ? 100.0 * d.lastBlockCpuSeconds / blockSeconds : 0.0, 2) + "%",
+               8, 38, getWidth() - 16, 16, juce::Justification::centredLeft);
+    
+    paintHistogram(g, { 8, 60, getWidth() - 16, 76 }, d.errorBins, TimingDiagnostics::numErrorBins, "Tick error: 0 to 2 samples (last: later/forced)");
+    paintHistogram(g, { 8, 144, getWidth() - 16, 76 }, d.blockSizeBins, TimingDiagnostics::numBlockSizeBins, "Block sizes: 16 to 4096+ samples");
+}
+
+void MidronomeAudioProcessorEditor::paintHistogram (juce::Graphics& g, juce::Rectangle<int> area, const uint64_t* bins, int numBins, const juce::String& title)
+{
+    g.setColour(juce::Colours::grey);
+    g.setFont(11.0f);
+    g.drawText(title, area.removeFromTop(14), juce::Justification::centredLeft);
+    g.drawRect(area);
+    
+    uint64_t maxCount = 1;
+    for (auto i = 0; i < numBins; i++)
+        maxCount = std::max(maxCount, bins[i]);
+    
+    auto barWidth = static_cast<float>(area.getWidth() - 2) / static_cast<float>(numBins);
+    auto maxHeight = static_cast<float>(area.getHeight() - 2);
+    
+    g.setColour(juce::Colours::white);
+    for (auto i = 0; i < numBins; i++) {
+        auto height = maxHeight * static_cast<float>(static_cast<double>(bins[i]) / static_cast<double>(maxCount));
+        g.fillRect(static_cast<float>(area.getX() + 1) + barWidth * static_cast<float>(i) + 1.0f, static_cast<float>(area.getBottom() - 1) - height,
+                   barWidth - 2.0f, height);
+    }
+}
+
+//==============================================================================
+juce::AudioProcessorEditor* createMidronomeEditor (MidronomeAudioProcessor& p)
+{
+    return new MidronomeAudioProcessorEditor (p);
 }
@@ -29,7 +29,8 @@
 #include "PluginProcessor.h"
 
 //==============================================================================
-class MidronomeAudioProcessorEditor  : public juce::AudioProcessorEditor
+class MidronomeAudioProcessorEditor  : public juce::AudioProcessorEditor,
+                                       private juce::Timer
 {
 public:
     MidronomeAudioProcessorEditor (MidronomeAudioProcessor&);
@@ -40,7 +41,22 @@ public:
     void resized() override;
 
 private:
+    void timerCallback() override;
+    
+    void paintDiagnostics (juce::Graphics& g);
+    void paintHistogram (juce::Graphics& g, juce::Rectangle<int> area, const uint64_t* bins, int numBins, const juce::String& title);
+    
     MidronomeAudioProcessor& audioProcessor;
+    
+    // settings view, the parameters of the processor (see createParameterLayout) in place of the logo
+    juce::TextButton settingsButton { "Settings" };
+    juce::GenericAudioProcessorEditor settingsView;
+    
+    // diagnostics view, showing the processor's TimingDiagnostics instead of the logo (refreshed by the timer while shown)
+    juce::TextButton diagnosticsButton { "Timing" };
+    bool showDiagnostics = false;
+    TimingDiagnostics::Snapshot diagnostics, previousDiagnostics;
+    double tickRate = 0.0; // ticks per second of audio, between the last 2 snapshots
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidronomeAudioProcessorEditor)
 };
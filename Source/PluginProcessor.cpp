@@ -31,10 +31,10 @@
 */
 
 #include "PluginProcessor.h"
-#include "PluginEditor.h"
 
 //==============================================================================
-MidronomeAudioProcessor::MidronomeAudioProcessor()
+template <typename Outputs>
+MidronomeProcessor<Outputs>::MidronomeProcessor()
 #ifndef JucePlugin_PreferredChannelConfigurations
      : AudioProcessor (BusesProperties()
                      #if ! JucePlugin_IsMidiEffect
@@ -42,26 +42,164 @@ MidronomeAudioProcessor::MidronomeAudioProcessor()
                        .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
                       #endif
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
+                       .withOutput ("Clock outputs", juce::AudioChannelSet::discreteChannels (numClockOutputs), false)
+                       .withOutput ("Timecode", juce::AudioChannelSet::mono(), false)
                      #endif
                        )
 #endif
+     , parameters (*this, nullptr, "Midronome", createParameterLayout())
 {
-    outputData = NULL;
+    pulseLengthParameter = parameters.getRawParameterValue("pulseLength");
+    pulseHeightParameter = parameters.getRawParameterValue("pulseHeight");
+    invertPulsesParameter = parameters.getRawParameterValue("invertPulses");
+    tickOffsetParameter = parameters.getRawParameterValue("tickOffset");
+    minTempoParameter = parameters.getRawParameterValue("minTempo");
+    maxTempoParameter = parameters.getRawParameterValue("maxTempo");
+    subSampleTicksParameter = parameters.getRawParameterValue("subSampleTicks");
+    timecodeFrameRateParameter = parameters.getRawParameterValue("timecodeFrameRate");
+    latencyCompensationParameter = parameters.getRawParameterValue("latencyCompensation");
+    latencyCompensationMsParameter = parameters.getRawParameterValue("latencyCompensationMs");
+    midiClockOutputParameter = parameters.getRawParameterValue("midiClockOutput");
+    midiClockInputParameter = parameters.getRawParameterValue("midiClockInput");
+    for (auto i = 0; i < numClockOutputs; i++) {
+        auto& outputParameters = clockOutputParameters[static_cast<size_t>(i)];
+        outputParameters.ppqn = parameters.getRawParameterValue(getClockOutputParameterID(i, "Ppqn"));
+        outputParameters.divide = parameters.getRawParameterValue(getClockOutputParameterID(i, "Divide"));
+        outputParameters.swing = parameters.getRawParameterValue(getClockOutputParameterID(i, "Swing"));
+        outputParameters.offsetTicks = parameters.getRawParameterValue(getClockOutputParameterID(i, "OffsetTicks"));
+        outputParameters.offsetMs = parameters.getRawParameterValue(getClockOutputParameterID(i, "OffsetMs"));
+    }
+    
+    for (auto* parameter : AudioProcessor::getParameters()) // not the value tree state of our getParameters()
+        if (auto* rangedParameter = dynamic_cast<juce::RangedAudioParameter*>(parameter))
+            parameters.addParameterListener(rangedParameter->paramID, this);
+    
+    tickPulse.length = 0; // set from the parameters with the audio outputs
+    tickPulse.maxLength = 0; // the pulse tables are allocated in prepareToPlay
+    tickPulse.shapesLength[0] = tickPulse.shapesLength[1] = 0;
+    tickPulse.currentShapes = 0;
+    subSampleTicks = false;
+    latencyCompensation = LatencyCompensation::off;
+    latencyCompensationMs = 0.0;
+    midiClockOutput = false;
+    midiClockInput = false;
+    
+    for (auto i = 0; i < numClockOutputs; i++) {
+        auto& output = clockOutputs[static_cast<size_t>(i)];
+        output.ppqn = defaultClockOutputPpqn[i];
+        output.divide = 1;
+        output.swing = 0.5;
+        output.offsetTicks = 0.0;
+        output.offsetMs = 0.0;
+    }
+    
+    auto traceDir = juce::SystemStats::getEnvironmentVariable("MIDRONOME_TRACE_DIR", {});
+    if (traceDir.isNotEmpty())
+        telemetry.startRecording(juce::File(traceDir).getNonexistentChildFile("Midronome", ".mdtr"));
 }
 
-MidronomeAudioProcessor::~MidronomeAudioProcessor()
+template <typename Outputs>
+MidronomeProcessor<Outputs>::~MidronomeProcessor()
 {
-    if(outputData != NULL)
-        delete [] outputData;
+    for (auto* parameter : AudioProcessor::getParameters())
+        if (auto* rangedParameter = dynamic_cast<juce::RangedAudioParameter*>(parameter))
+            parameters.removeParameterListener(rangedParameter->paramID, this);
+    
+    cancelPendingUpdate();
+}
+
+// the pulse parameters only exist with the audio outputs, the timing ones also apply to MIDI clock
+// the settings of the audio buses are not automatable: the host saves them, and the editor's settings view changes them
+template <typename Outputs>
+juce::AudioProcessorValueTreeState::ParameterLayout MidronomeProcessor<Outputs>::createParameterLayout()
+{
+    juce::AudioProcessorValueTreeState::ParameterLayout layout;
+    
+    if constexpr (Outputs::audioPulses) {
+        layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID { "pulseLength", 1 }, "Pulse length",
+                                                               juce::NormalisableRange<float>(0.5f, maxPulseLengthMs, 0.01f), 0.5f,
+                                                               juce::AudioParameterFloatAttributes().withLabel("ms")));
+        layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID { "pulseHeight", 1 }, "Pulse height",
+                                                               juce::NormalisableRange<float>(0.1f, 1.0f, 0.01f), 0.9f));
+        layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID { "invertPulses", 1 }, "Invert pulses", false));
+        layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID { "subSampleTicks", 2 }, "Sub-sample ticks", false,
+                                                              juce::AudioParameterBoolAttributes().withAutomatable(false)));
+        
+        for (auto i = 0; i < numClockOutputs; i++) {
+            auto name = "Clock output " + juce::String(i + 1);
+            layout.add(std::make_unique<juce::AudioParameterInt>(juce::ParameterID { getClockOutputParameterID(i, "Ppqn"), 2 }, name + " resolution",
+                                                                 1, 96, defaultClockOutputPpqn[i],
+                                                                 juce::AudioParameterIntAttributes().withLabel("ppqn").withAutomatable(false)));
+            layout.add(std::make_unique<juce::AudioParameterInt>(juce::ParameterID { getClockOutputParameterID(i, "Divide"), 2 }, name + " divide",
+                                                                 1, 96, 1, juce::AudioParameterIntAttributes().withAutomatable(false)));
+            layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID { getClockOutputParameterID(i, "Swing"), 2 }, name + " swing",
+                                                                   juce::NormalisableRange<float>(50.0f, 75.0f, 0.1f), 50.0f,
+                                                                   juce::AudioParameterFloatAttributes().withLabel("%").withAutomatable(false)));
+            layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID { getClockOutputParameterID(i, "OffsetTicks"), 2 }, name + " offset",
+                                                                   juce::NormalisableRange<float>(-24.0f, 24.0f, 0.01f), 0.0f,
+                                                                   juce::AudioParameterFloatAttributes().withLabel("ticks").withAutomatable(false)));
+            layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID { getClockOutputParameterID(i, "OffsetMs"), 2 }, name + " offset (ms)",
+                                                                   juce::NormalisableRange<float>(-50.0f, 50.0f, 0.1f), 0.0f,
+                                                                   juce::AudioParameterFloatAttributes().withLabel("ms").withAutomatable(false)));
+        }
+        
+        layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID { "timecodeFrameRate", 2 }, "Timecode frame rate",
+                                                                juce::StringArray { "24 fps", "25 fps", "29.97 fps drop frame", "30 fps" },
+                                                                static_cast<int>(LtcEncoder::FrameRate::fps25),
+                                                                juce::AudioParameterChoiceAttributes().withAutomatable(false)));
+    }
+    
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID { "tickOffset", 1 }, "Tick offset",
+                                                           juce::NormalisableRange<float>(-20.0f, 20.0f, 0.1f), 0.0f,
+                                                           juce::AudioParameterFloatAttributes().withLabel("ms")));
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID { "minTempo", 1 }, "Minimum tempo",
+                                                           juce::NormalisableRange<float>(30.0f, 400.0f, 1.0f), 30.0f,
+                                                           juce::AudioParameterFloatAttributes().withLabel("bpm")));
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID { "maxTempo", 1 }, "Maximum tempo",
+                                                           juce::NormalisableRange<float>(30.0f, 400.0f, 1.0f), 400.0f,
+                                                           juce::AudioParameterFloatAttributes().withLabel("bpm")));
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID { "latencyCompensation", 2 }, "Latency compensation",
+                                                            juce::StringArray { "Off", "Report to host", "Lookahead" }, 0,
+                                                            juce::AudioParameterChoiceAttributes().withAutomatable(false)));
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID { "latencyCompensationMs", 2 }, "Latency compensation time",
+                                                           juce::NormalisableRange<float>(0.0f, 100.0f, 0.1f), 0.0f,
+                                                           juce::AudioParameterFloatAttributes().withLabel("ms").withAutomatable(false)));
+    
+    if constexpr (Outputs::midiMessages) {
+        layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID { "midiClockOutput", 2 }, "MIDI clock output", false,
+                                                              juce::AudioParameterBoolAttributes().withAutomatable(false)));
+    }
+    
+   #if JucePlugin_WantsMidiInput
+    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID { "midiClockInput", 2 }, "Follow MIDI clock input", false,
+                                                          juce::AudioParameterBoolAttributes().withAutomatable(false)));
+   #endif
+    
+    return layout;
+}
+
+template <typename Outputs>
+juce::String MidronomeProcessor<Outputs>::getClockOutputParameterID(int output, const char* name)
+{
+    return "clockOutput" + juce::String(output + 1) + name;
+}
+
+template <typename Outputs>
+void MidronomeProcessor<Outputs>::setParameter(const juce::String& parameterID, float value)
+{
+    if (auto* parameter = parameters.getParameter(parameterID))
+        parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
 }
 
 //==============================================================================
-const juce::String MidronomeAudioProcessor::getName() const
+template <typename Outputs>
+const juce::String MidronomeProcessor<Outputs>::getName() const
 {
     return JucePlugin_Name;
 }
 
-bool MidronomeAudioProcessor::acceptsMidi() const
+template <typename Outputs>
+bool MidronomeProcessor<Outputs>::acceptsMidi() const
 {
    #if JucePlugin_WantsMidiInput
     return true;
@@ -70,7 +208,8 @@ bool MidronomeAudioProcessor::acceptsMidi() const
    #endif
 }
 
-bool MidronomeAudioProcessor::producesMidi() const
+template <typename Outputs>
+bool MidronomeProcessor<Outputs>::producesMidi() const
 {
    #if JucePlugin_ProducesMidiOutput
     return true;
@@ -79,7 +218,8 @@ bool MidronomeAudioProcessor::producesMidi() const
    #endif
 }
 
-bool MidronomeAudioProcessor::isMidiEffect() const
+template <typename Outputs>
+bool MidronomeProcessor<Outputs>::isMidiEffect() const
 {
    #if JucePlugin_IsMidiEffect
     return true;
@@ -88,86 +228,134 @@ bool MidronomeAudioProcessor::isMidiEffect() const
    #endif
 }
 
-double MidronomeAudioProcessor::getTailLengthSeconds() const
+template <typename Outputs>
+double MidronomeProcessor<Outputs>::getTailLengthSeconds() const
 {
     return 0.0;
 }
 
-int MidronomeAudioProcessor::getNumPrograms()
+template <typename Outputs>
+int MidronomeProcessor<Outputs>::getNumPrograms()
 {
     return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
                 // so this should be at least 1, even if you're not really implementing programs.
 }
 
-int MidronomeAudioProcessor::getCurrentProgram()
+template <typename Outputs>
+int MidronomeProcessor<Outputs>::getCurrentProgram()
 {
     return 0;
 }
 
-void MidronomeAudioProcessor::setCurrentProgram (int index)
+template <typename Outputs>
+void MidronomeProcessor<Outputs>::setCurrentProgram (int index)
 {
 }
 
-const juce::String MidronomeAudioProcessor::getProgramName (int index)
+template <typename Outputs>
+const juce::String MidronomeProcessor<Outputs>::getProgramName (int index)
 {
     return {};
 }
 
-void MidronomeAudioProcessor::changeProgramName (int index, const juce::String& newName)
+template <typename Outputs>
+void MidronomeProcessor<Outputs>::changeProgramName (int index, const juce::String& newName)
 {
 }
 
 //==============================================================================
-void MidronomeAudioProcessor::prepareToPlay (double sr, int samplesPerBlock)
+template <typename Outputs>
+void MidronomeProcessor<Outputs>::prepareToPlay (double sr, int samplesPerBlock)
 {
     sampleRate = sr;
     
-    if (outputData != NULL)
-        delete [] outputData;
-    outputData = new float[samplesPerBlock];
-    
     hasSyncStarted = false;
-    currentlySendingTickPulse = false;
+    tickPulse.state.isBeingSent = false;
+    expectedTimeInSamples = 0;
+    previousBlockPpqPos = 0.0;
+    previousBlockNumSamples = 0;
+    lastTickNo = invalidTickNo;
+    isExtraTickSent = false;
+    
+    updateReportedLatency(sampleRate);
+    isLoopWrapExpected = false;
+    expectedPpqPos = 0.0;
+    loopPassOffset = 0;
+    catchUpSamples = 0;
+    midiClockState = MidiClockState::stopped;
+    midiClockFollower.prepare(sampleRate);
+    ltcEncoder.prepare(sampleRate, ltcEncoder.getFrameRate()); // then at the rate of the parameter, from updateParameters()
     
     lastValueSent[BPM] = 0;
     waitBeforeSending[BPM] = 0;
     lastValueSent[BEATS_PER_BAR] = 0;
     waitBeforeSending[BEATS_PER_BAR] = 0;
     
-    tickPulseLength = 24; // 0.5ms at 48kHz, a bit more at 44.1kHz
+    tickPulse.samplesPerMs = 48; // 0.5ms is 24 samples at 48kHz, a bit more at 44.1kHz
     if (sampleRate > 50000.0) // 88.2 and 96 kHz
-        tickPulseLength *= 2;
+        tickPulse.samplesPerMs *= 2;
     if (sampleRate > 100000.0) // 176.4 and 192 kHz
-        tickPulseLength *= 2;
+        tickPulse.samplesPerMs *= 2;
     
-    // set to tempo limits to 29.9bpm -> 400.2bpm - ticks will always be sent according to these
-    minSamplesNumBetweenTicks = static_cast<int64_t>(sampleRate / ( (400.2*24.0)/60.0 ));
-    maxSamplesNumBetweenTicks = static_cast<int64_t>(sampleRate / ( (29.9*24.0)/60.0 ));
+    buildTickPulseTable();
+    tickPulse.state = { 0, 0, 0, 0, 0.0f, false, nullptr };
     
-#ifdef DEBUG
-    LOGGER.reset();
-#endif
+    // the channels of the buses in the buffers of processBlock: hosts only change the layout while the processor is
+    // released, and prepare it again after, so it is not queried for every block
+    numMainChannels = getMainBusNumOutputChannels();
+    numClockChannels = std::min(getBusCount(false) > 1 ? getChannelCountOfBus(false, 1) : 0, numClockOutputs);
+    firstClockChannel = numClockChannels > 0 ? getChannelIndexInProcessBlockBuffer(false, 1, 0) : 0;
+    timecodeChannel = getBusCount(false) >= 3 && getChannelCountOfBus(false, 2) > 0 ? getChannelIndexInProcessBlockBuffer(false, 2, 0) : -1;
+    
+    for (auto& output : clockOutputs) {
+        output.lastPulseNo = 0;
+        output.isSynced = false;
+        output.samplesSinceLastPulse = 0;
+        output.pulse = { 0, 0, 0, 0, 0.0f, false, nullptr };
+    }
+    
+    parametersChanged.store(true, std::memory_order_relaxed); // the values in samples depend on the sample rate
+    updateParameters();
+    samplesSinceLastTick = maxSamplesNumBetweenTicks; // no tick sent yet, the first one can be sent right away
+    
+    TelemetryRecorder::Event event {};
+    event.type = TelemetryRecorder::prepareEvent;
+    event.bpm = sampleRate;
+    event.timeInSamples = -1;
+    event.sampleOffset = samplesPerBlock;
+    telemetry.push(event);
+    
+    diagnostics.reset(sampleRate);
 }
 
-void MidronomeAudioProcessor::releaseResources()
+template <typename Outputs>
+void MidronomeProcessor<Outputs>::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
-bool MidronomeAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
+template <typename Outputs>
+bool MidronomeProcessor<Outputs>::isBusesLayoutSupported (const BusesLayout& layouts) const
 {
   #if JucePlugin_IsMidiEffect
     juce::ignoreUnused (layouts);
     return true;
   #else
     // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // The tick pulse is the same in every channel of the main output, which
+    // is stereo by default: some plugin hosts, such as certain GarageBand
+    // versions, will only load plugins that support stereo bus layouts.
+    // It can be set from mono up to 8 channels for multichannel interfaces.
+    auto numMainOutputs = layouts.getMainOutputChannelSet().size();
+    if (numMainOutputs < 1 || numMainOutputs > maxMainOutputChannels)
+        return false;
+
+    // the clock outputs bus can have fewer channels than clock outputs, or be disabled
+    if (layouts.getNumChannels (false, 1) > numClockOutputs)
+        return false;
+    if (layouts.getNumChannels (false, 2) > 1)
         return false;
 
     // This checks if the input layout matches the output layout
@@ -183,9 +371,19 @@ bool MidronomeAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts
 
 
 
-void MidronomeAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+//==============================================================================
+// the engine, shared by the float and double precision processBlock - the ppq math is in double precision
+// anyway, only the pulses rendered in the buffer depend on SampleType
+template <typename Outputs>
+template <typename SampleType>
+void MidronomeProcessor<Outputs>::processSamples(juce::AudioBuffer<SampleType>& buffer, juce::MidiBuffer& midiMessages) MIDRONOME_NONBLOCKING
 {
-    juce::ScopedNoDenormals noDenormals;
+    // no ScopedNoDenormals: nothing here feeds back its output (the pulses are copied from tables, and the LTC is computed
+    // from the host time), so no denormal can build up, and saving and restoring the FPU flags costs more than small blocks
+    MIDRONOME_BEGIN_UNCHECKED_CALLS // a read of the CPU clock
+    auto isCpuTimeShown = diagnostics.isCpuTimeShown(); // only while the editor's diagnostics view is open
+    auto blockStartTicks = isCpuTimeShown ? juce::Time::getHighResolutionTicks() : 0;
+    MIDRONOME_END_UNCHECKED_CALLS
     
     
     
@@ -194,19 +392,38 @@ void MidronomeAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, ju
     
     auto totalNumSamples = buffer.getNumSamples();
     
-    auto info = getPlayHead()->getPosition();
+    // some hosts call processBlock without any sample (to flush parameter changes in VST3): no time passes, nothing is sent
+    if (totalNumSamples == 0)
+        return;
+    
+    updateParameters();
+    
+    auto info = getHostPosition(); // always has a value
+    if (midiClockInput) // the transport of the incoming MIDI clock replaces the host's
+        info = midiClockFollower.process(midiMessages, totalNumSamples, info);
+    
     auto timeSig = info->getTimeSignature();
     auto isPlaying = info->getIsPlaying();
     
     int beatsPerBar = 4; // 4/4 time sig per default
+    auto barLength = 4.0; // in quarter notes, 3.5 in 7/8
     auto bpm = info->getBpm().orFallback(0.0);
     
     bool timeSigIn8 = false;
-
-    // clear buffers
+    
+    // the MIDI clock output was switched off, or on while the sync runs: the receiver is stopped, or joins on the next 16th note
+    if (!midiClockOutput && midiClockState != MidiClockState::stopped)
+        stopMidiClock(false, midiMessages);
+    else if (hasSyncStarted && midiClockState == MidiClockState::stopped)
+        midiClockState = MidiClockState::waitingToContinue;
+    
+    // the ticks are scheduled on the timeline that many samples ahead of the host (or behind if < 0)
+    auto aheadSamples = lookaheadSamples - tickOffsetSamples;
+    
+    // clear buffer - it stays marked as cleared if no tick pulse is rendered in this block
+    MIDRONOME_BEGIN_UNCHECKED_CALLS // a memset of each channel
     buffer.clear();
-    for (auto i = 0; i < totalNumSamples; i++)
-        outputData[i] = 0;
+    MIDRONOME_END_UNCHECKED_CALLS
     
     
     
@@ -214,134 +431,238 @@ void MidronomeAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, ju
     /// ### SEND TIME SIGNATURE OVER USB ###
     if (timeSig.hasValue()) {
         beatsPerBar = (4 * timeSig->numerator) / (timeSig->denominator);
+        barLength = 4.0 * timeSig->numerator / timeSig->denominator;
         auto beatPerBarToSend = beatsPerBar;
         if (timeSig->denominator == 8) {
             beatPerBarToSend = timeSig->numerator;
             timeSigIn8 = true;
         }
         
-        sendMidiToHost(BEATS_PER_BAR, beatPerBarToSend, totalNumSamples, isPlaying, midiMessages);
+        if (beatPerBarToSend >= 1 && beatPerBarToSend <= 0x7F) // 7 bits, and there is no whole beat in a bar of 3/16
+            sendMidiToHost(BEATS_PER_BAR, beatPerBarToSend, totalNumSamples, isPlaying, midiMessages);
     }
     
     
     
-    /// ### PREPARATIONS BEFORE SAMPLE LOOP ###
+    /// ### PREPARATIONS BEFORE TICK SCHEDULING ###
         
-    if (isPlaying && bpm >= 30.0 && bpm <= 400.0)
+    if (isPlaying && bpm >= minSyncBpm && bpm <= maxSyncBpm)
     {
-        
-#ifdef DEBUG
-        if (!LOGGER.prevPlayingStatus) {
-            LOGGER.reset();
-            LOGGER.prevPlayingStatus = true;
-        }
-        LOGGER.logBlockInfo(info);
-#endif
-        
         auto dppqPerSample = bpm / (60.0*sampleRate);
-        auto currentPpqPos = info->getPpqPosition().orFallback(0.0);
+        auto blockStartPpqPos = info->getPpqPosition().orFallback(0.0);
         
         lastValueSent[BPM] = 0;
         waitBeforeSending[BPM] = -1; // to indicate to sendMidiToHost() to delay sending
         
-        // checking playing continuity (if playhead moved manually or we looped f.x.)
+        // the loop, as long as the host is before its end (otherwise it plays on past it)
+        auto loopPoints = info->getLoopPoints();
+        auto loopStartPpqPos = loopPoints.hasValue() ? loopPoints->ppqStart : 0.0;
+        auto loopEndPpqPos = loopPoints.hasValue() ? loopPoints->ppqEnd : 0.0;
+        auto loopLength = loopEndPpqPos - loopStartPpqPos;
+        auto isLooping = info->getIsLooping() && loopLength > 0.0 && blockStartPpqPos < loopEndPpqPos;
+        
+        // checking playing continuity (if playhead moved manually f.x.) - when the host wraps to the loop start as expected,
+        // its time jumps back (in most hosts) but the ticks continue: they were already scheduled across the loop seam
+        // hosts which do not give the time in samples are checked on the ppq position predicted by the previous block instead,
+        // so the tick count is kept (and nothing drifts) however long they play
         auto curTimeInSamples = info->getTimeInSamples();
-        if (!curTimeInSamples.hasValue() || std::abs(curTimeInSamples.orFallback(0) - expectedTimeInSamples) > 2)
-            lastTickNo = -1; // if the playhead has been moved by more than 2 samples, we make lastTickNo invalid
+        auto hasLoopWrapped = isLoopWrapExpected && std::abs(blockStartPpqPos - (expectedPpqPos - loopLength)) <= 2.0*dppqPerSample;
+        auto isContinuous = hasLoopWrapped
+                            || (curTimeInSamples.hasValue() && std::abs(curTimeInSamples.orFallback(0) - expectedTimeInSamples) <= 2)
+                            || (!curTimeInSamples.hasValue() && previousBlockNumSamples > 0 && std::abs(blockStartPpqPos - expectedPpqPos) <= 2.0*dppqPerSample);
+        if (!isContinuous) {
+            lastTickNo = invalidTickNo; // if the playhead has been moved by more than 2 samples, we make lastTickNo invalid
+            isExtraTickSent = false;
+            for (auto& output : clockOutputs)
+                output.isSynced = false;
+            stopMidiClock(true, midiMessages);
+            diagnostics.discontinuity();
+        }
+        
+        if (hasLoopWrapped)
+            loopPassOffset--;
+        if (!isContinuous || !isLooping)
+            loopPassOffset = 0;
         
         expectedTimeInSamples = curTimeInSamples.orFallback(0) + totalNumSamples; // for next block check
         
+        // during host tempo ramps, the bpm given for this block is only valid at its start: the average tempo of the previous
+        // block (from the ppq positions) is the tempo at its middle, which gives us the tempo slope to integrate over this block
+        // (not with the MIDI clock input: its position is corrected at each clock, which would look like ramps in short blocks)
+        auto dppqSlope = 0.0;
+        if (isContinuous && previousBlockNumSamples > 0 && totalNumSamples > 0 && !midiClockInput) {
+            auto previousDppqPerSample = (blockStartPpqPos + (hasLoopWrapped ? loopLength : 0.0) - previousBlockPpqPos) / static_cast<double>(previousBlockNumSamples);
+            
+            if (std::abs(previousDppqPerSample - dppqPerSample) < 0.05*dppqPerSample) { // otherwise the ppq position jumped (or the tempo did)
+                dppqSlope = (dppqPerSample - previousDppqPerSample) / (0.5*static_cast<double>(previousBlockNumSamples));
+                
+                // the tempo cannot change by more than half during this block (and the lookahead), so the ppq position keeps moving forward
+                auto maxSlope = 0.5*dppqPerSample / static_cast<double>(totalNumSamples + std::max(0, aheadSamples));
+                dppqSlope = juce::jlimit(-maxSlope, maxSlope, dppqSlope);
+            }
+        }
+        
+        previousBlockPpqPos = blockStartPpqPos;
+        previousBlockNumSamples = totalNumSamples;
+        
+        recordBlock(info, totalNumSamples, isContinuous ? TelemetryRecorder::isContinuous : 0);
+        
+        
+        
+        
+        /// ### TICK SCHEDULING ###
+        // Instead of checking every sample, we compute directly the sample offsets at which the next ticks
+        // fall in this block (from the block start ppq and dppqPerSample), and only render those pulses
         
+        BlockTimeline timeline { blockStartPpqPos, dppqPerSample, dppqSlope, totalNumSamples };
         
+        // the host position after this block, or back at the loop start
+        expectedPpqPos = timeline.getPpqPosAt(totalNumSamples);
+        isLoopWrapExpected = isLooping && expectedPpqPos >= loopEndPpqPos - LoopSeam::tolerancePpq;
         
-        /// ### MAIN SAMPLE LOOP ###
+        // with the lookahead (or an early tick offset), everything is scheduled on the timeline predicted aheadSamples ahead, which
+        // wraps to the loop start aheadSamples before the host does (or after it with a late tick offset)
+        if (aheadSamples != 0)
+            timeline = timeline.shiftedBy(static_cast<double>(aheadSamples));
+        timeline.startPpqPos -= static_cast<double>(loopPassOffset) * loopLength;
         
-        for (auto i = 0; i < totalNumSamples; i++)
+        // when the timeline reaches the loop end in this block, the ticks scheduled from there are the ones from the loop start
+        auto seam = LoopSeam::find(timeline, isLooping, loopStartPpqPos, loopEndPpqPos);
+        auto tickTimeline = timeline;
+        auto hasCrossedSeam = false;
+        
+        // from the seam on, the ticks continue from the loop start, and the MIDI clock receiver is relocated there
+        auto crossSeam = [&]
         {
-            if (currentPpqPos >= 0.0) { // will be < 0 during pre-rolls, maybe a block before it starts, and sometimes when positionOfLastBarStart is after
-                double errorRange = 20.0*dppqPerSample; // 20 samples error range because of rounding and samples not "landing" exactly on a tick
-                
-                // we start the sync when we are almost 0 modulo beatsPerBar quarternotes, i.e. start of a bar
-                if (!hasSyncStarted) {
-                    auto ppqPosFromLastBar = currentPpqPos - info->getPpqPositionOfLastBarStart().orFallback(0.0); // to check with beatsPerBar we need to start from the last bar
-                    
-                    if (fmod(ppqPosFromLastBar, static_cast<double>(beatsPerBar)) < errorRange) {
-                        hasSyncStarted = true;
-                        
-                        // sync always starts by sending a tick, so this ensures samplesSinceLastTick => maxSamplesNumBetweenTicks to send the tick below
-                        samplesSinceLastTick = static_cast<int64_t>(sampleRate);
-                        lastTickNo = -1;
-                    }
-                }
+            tickTimeline = seam.wrapped;
+            hasCrossedSeam = true;
+            if (lastTickNo != invalidTickNo) {
+                lastTickNo = seam.getFirstTickNo() - 1;
+                isExtraTickSent = false;
+                stopMidiClock(true, midiMessages, static_cast<int>(juce::jlimit<int64_t>(0, std::max(0, totalNumSamples - 1), seam.wrapSample)));
+            }
+        };
+        
+        int64_t lastTickSample = -samplesSinceLastTick; // position of the last tick, relative to the start of this block
+        
+        // ppq pos will be < 0 during pre-rolls, maybe a block before it starts, and sometimes when positionOfLastBarStart is after
+        auto firstValidSample = timeline.getFirstSampleReaching(0.0, 0);
+        
+        // finish sending the pulse started in the previous block if needed - no tick can be sent before it ends
+        auto nextCandidate = std::max(renderTickPulse(tickPulse.state, buffer, 0, numMainChannels, 0), firstValidSample);
+        auto syncFromSample = firstValidSample;
+        auto maxClockLateSamples = 20.0;
+        
+        // we start the sync on the first sample of a bar: the next bar start is computed once per block from the timeline, and
+        // the first tick is sent on it - from a pre-roll, that is the bar at 0 (no tick is sent before it)
+        // the bar can be up to 1 sample before the block, if it fell between the last sample of the previous block and this
+        // one, and with the lookahead the predicted position is already past the bar when the transport starts on it: the
+        // sync then starts right away from that bar, and the ticks catch up with the predicted grid (at most 1 every 6.25ms)
+        // - likewise when the MIDI clock input only gave its tempo after the first clock following Start, from the bar of that clock
+        if (!hasSyncStarted) {
+            auto startLateSamples = std::max(0, aheadSamples) + (midiClockInput ? static_cast<int>(midiClockFollower.getStartLateSamples()) : 0);
+            auto maxLateSamples = 1.0 + startLateSamples;
+            auto barPpqPos = 0.0;
+            auto lastBarPpqPos = info->getPpqPositionOfLastBarStart().orFallback(0.0);
+            auto syncStartSample = findSyncStartSample(tickTimeline, firstValidSample, lastBarPpqPos, barLength, maxLateSamples, barPpqPos);
+            
+            if (syncStartSample >= seam.wrapSample && syncStartSample < totalNumSamples) { // the bar found is past the loop end
+                crossSeam();
+                syncStartSample = findSyncStartSample(tickTimeline, tickTimeline.getFirstSampleReaching(0.0, seam.wrapSample), lastBarPpqPos, barLength, maxLateSamples, barPpqPos);
+            }
+            
+            if (syncStartSample < totalNumSamples) {
+                hasSyncStarted = true;
                 
-                if (hasSyncStarted && !currentlySendingTickPulse) {
-                    bool sendTick = false;
-                    auto tickPos = currentPpqPos*24.0;
-                    auto currentTickNo = static_cast<int64_t>(tickPos);
-                    auto tickRest = tickPos - floor(tickPos); // decimals of the current tick position
-                    bool extraTickInTimeSig8 = false;
-                    
-                    if (lastTickNo >= 0) { // if we have a valid last tick position
-                        if (currentTickNo > lastTickNo) { // if there is 1 (or more) tick between current and last tick => we send a tick
-                            sendTick = true;
-                        }
-                        else if (timeSigIn8 && (currentTickNo == lastTickNo)) { // in time signatures in x/8 we send twice as many ticks
-                            tickRest -= 0.5;
-                            if (tickRest >= 0 && tickRest < errorRange*24.0) {
-                                sendTick = true;
-                                extraTickInTimeSig8 = true;
-                            }
-                        }
-                        // else {} -> we already sent current (or more) tick and there are no extra tick in x/8 time sig => we wait
-                        
-                    }
-                    else { // if we do not have a valid last tick (sync just started, or playhead has moved)
-                        if (tickRest < errorRange*24.0)
-                            sendTick = true;
-                    }
-                    
-                    
-                    // we do not send a tick if it will give a tempo > 400bpm, and we make sure to send one to avoid tempo < 30bpm
-                    if ( (sendTick && samplesSinceLastTick >= minSamplesNumBetweenTicks) || samplesSinceLastTick >= maxSamplesNumBetweenTicks) {
-                        if (lastTickNo < 0)
-                            lastTickNo = currentTickNo; // we "initialize" lastTickNo if it was not valid
-                        else if (!extraTickInTimeSig8)
-                            lastTickNo++; // we increment if it was valid, but not for the extra tick in x/8 time sig
-                        samplesSinceLastTick = 0;
-                        currentlySendingTickPulse = true;
-#ifdef DEBUG
-                        LOGGER.logTickPulseSent(currentPpqPos, lastTickNo, info);
-#endif
-                    }
-                }
+                // sync always starts by sending a tick, on the bar - or up to minSamplesNumBetweenTicks later, if the transport
+                // restarts right after a tick (lastTickSample is kept, so the first tick is not closer to it)
+                lastTickNo = static_cast<int64_t>(std::round(barPpqPos*24.0)) - 1; // the first tick is the one of the bar
+                isExtraTickSent = false;
+                catchUpSamples = startLateSamples;
+                if (midiClockOutput && midiClockState == MidiClockState::stopped)
+                    midiClockState = MidiClockState::waitingToStart;
+                nextCandidate = std::max(nextCandidate, syncStartSample);
+                syncFromSample = syncStartSample;
+                maxClockLateSamples = maxLateSamples;
+            }
+        }
+        
+        while (hasSyncStarted && nextCandidate < totalNumSamples) {
+            bool extraTickInTimeSig8 = false;
+            double tickPpqPos = -1.0;
+            auto maxLateSamples = 20.0 + catchUpSamples; // so no extra tick in x/8 is skipped while catching up
+            auto tickSample = findNextTickSample(tickTimeline, nextCandidate, lastTickSample, timeSigIn8, maxLateSamples, extraTickInTimeSig8, tickPpqPos);
+            
+            // the next tick is past the loop end: the grid continues from the loop start instead, after the seam
+            if (!hasCrossedSeam && tickSample >= seam.wrapSample && (seam.isAfterLoopEnd(tickPpqPos) || tickPpqPos < 0.0 || lastTickNo == invalidTickNo)) {
+                crossSeam();
+                nextCandidate = std::max(nextCandidate, seam.wrapSample);
+                continue;
             }
             
-            outputData[i] = getCurrentTickPulseSample(); // updates currentlySendingTickPulse accordingly
-             
-            currentPpqPos += dppqPerSample; // increment current ppq pos based on the current BPM
-            samplesSinceLastTick++;
+            if (tickSample >= totalNumSamples)
+                break;
+            
+            if (lastTickNo == invalidTickNo)
+                lastTickNo = static_cast<int64_t>(tickTimeline.getPpqPosAt(tickSample)*24.0); // we "initialize" lastTickNo if it was not valid
+            else if (!extraTickInTimeSig8)
+                lastTickNo++; // we increment if it was valid, but not for the extra tick in x/8 time sig
+            isExtraTickSent = extraTickInTimeSig8;
+            lastTickSample = tickSample;
+            if (!extraTickInTimeSig8) // MIDI clock is always 24ppq
+                sendMidiClockTick(tickPpqPos >= 0.0, static_cast<int>(tickSample), midiMessages);
+            if (tickTimeline.getPpqPosAt(tickSample) - tickPpqPos < tickTimeline.dppqPerSample) // back on the grid
+                catchUpSamples = 0;
+            startTickPulse(tickPulse.state, getTickPulsePhase(tickTimeline, tickSample, tickPpqPos));
+            
+            uint16_t tickFlags = 0;
+            if (extraTickInTimeSig8)
+                tickFlags |= TelemetryRecorder::isExtraTickInTimeSig8;
+            if (tickPpqPos < 0.0)
+                tickFlags |= TelemetryRecorder::isForcedTick;
+            if (tickPulse.state.phase > 0)
+                tickFlags |= TelemetryRecorder::isSubSampleTick;
+            recordTick(info, tickSample, tickPpqPos < 0.0 ? tickTimeline.getPpqPosAt(tickSample) : tickPpqPos, tickFlags);
+            
+            auto pulseEdgeSample = static_cast<double>(tickSample) - static_cast<double>(tickPulse.state.phase) / numTickPulsePhases;
+            diagnostics.tickSent(tickPpqPos < 0.0 ? 0.0 : pulseEdgeSample - tickTimeline.getExactSampleAt(tickPpqPos), tickPpqPos >= 0.0);
+            
+            nextCandidate = renderTickPulse(tickPulse.state, buffer, 0, numMainChannels, tickSample); // no new tick until this pulse has ended
+        }
+        
+        samplesSinceLastTick = totalNumSamples - lastTickSample;
+        
+        if (seam.isInBlock()) {
+            if (!hasCrossedSeam) // no tick to send until the seam
+                crossSeam();
+            loopPassOffset++;
         }
+        
+        renderClockOutputs(timeline, seam, buffer, syncFromSample, maxClockLateSamples);
     }
-    
-    
-    
-    
+
+
+
+
     /// ### WHEN NOT PLAYING OR WHEN BPM IS OUT OF RANGE ###
     
     else
     {
-#ifdef DEBUG
-        if (LOGGER.prevPlayingStatus)
-            LOGGER.prevPlayingStatus = false;
-#endif
-            
+        recordBlock(info, totalNumSamples, 0);
+        
         hasSyncStarted = false;
+        catchUpSamples = 0;
+        stopMidiClock(false, midiMessages);
+        previousBlockNumSamples = 0;
+        samplesSinceLastTick += totalNumSamples; // so the first tick when the sync starts again is not too close to the last one
         
-        // Finish sending pulse if needed
-        if (currentlySendingTickPulse) {
-            for (auto i = 0; i < totalNumSamples; i++)
-                outputData[i] = getCurrentTickPulseSample(); // updates currentlySendingTickPulse accordingly
-        }
+        // Finish sending pulses if needed
+        renderTickPulse(tickPulse.state, buffer, 0, numMainChannels, 0);
+        
+        for (auto& output : clockOutputs)
+            output.isSynced = false;
+        BlockTimeline stoppedTimeline { 0.0, 0.0, 0.0, totalNumSamples };
+        renderClockOutputs(stoppedTimeline, LoopSeam::find(stoppedTimeline, false, 0.0, 0.0), buffer, totalNumSamples, 0.0);
         
         
         // Send BPM over USB if it is valid
@@ -353,24 +674,44 @@ void MidronomeAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, ju
     }
     
     
+    renderTimecode(info, buffer);
     
+    diagnostics.blockProcessed(totalNumSamples, isPlaying);
     
-    /// ### FILL ACTUAL OUTPUT BUFFER ###
-    
-    int numChannels = getTotalNumOutputChannels();
-    for (auto ch = 0 ; ch < numChannels ; ch++) {
-        auto* data = buffer.getWritePointer(ch);
-        
-        for (auto i = 0 ; i < totalNumSamples ; i++)
-            data[i] = outputData[i];
+    if (isCpuTimeShown) {
+        MIDRONOME_BEGIN_UNCHECKED_CALLS // a read of the CPU clock
+        diagnostics.cpuTimeMeasured(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - blockStartTicks));
+        MIDRONOME_END_UNCHECKED_CALLS
     }
-    
 }
 
 
+template <typename Outputs>
+void MidronomeProcessor<Outputs>::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) MIDRONOME_NONBLOCKING
+{
+    processSamples(buffer, midiMessages);
+}
 
+template <typename Outputs>
+void MidronomeProcessor<Outputs>::processBlock (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages) MIDRONOME_NONBLOCKING
+{
+    processSamples(buffer, midiMessages);
+}
 
-void MidronomeAudioProcessor::sendMidiToHost(values_type_t v, int newValue, int totalNumSamples, bool isPlaying, juce::MidiBuffer& midiMessages) {
+template <typename Outputs>
+bool MidronomeProcessor<Outputs>::supportsDoublePrecisionProcessing() const
+{
+    return true; // so hosts with a 64 bit engine do not have to convert our buffers
+}
+
+
+
+
+template <typename Outputs>
+void MidronomeProcessor<Outputs>::sendMidiToHost(values_type_t v, int newValue, int totalNumSamples, bool isPlaying, juce::MidiBuffer& midiMessages) MIDRONOME_NONBLOCKING {
+    if constexpr (! Outputs::midiMessages)
+        return;
+    
     if (lastValueSent[v] != newValue && waitBeforeSending[v] <= 0) {
         if (!isPlaying && (v != BPM || waitBeforeSending[v] == 0)) {  // no waiting time when not playing except for BPM the first time (with waitBeforeSending[v] = -1)
             waitBeforeSending[v] = 1;
@@ -388,13 +729,16 @@ void MidronomeAudioProcessor::sendMidiToHost(values_type_t v, int newValue, int
     else if (waitBeforeSending[v] > 0) {
         lastValueSent[v] = newValue;
         
-        if (v == BPM) {
-            // Bitwig seems to be the only DAW not transmitting the PitchWheel below but it will transmit the CC messages...
-            midiMessages.addEvent(juce::MidiMessage::controllerEvent(12, 85, newValue / 128), waitBeforeSending[v]);
-            midiMessages.addEvent(juce::MidiMessage::controllerEvent(12, 86, newValue % 128), waitBeforeSending[v]);
-        }
-        else {
-            midiMessages.addEvent(juce::MidiMessage::controllerEvent(12, 90, newValue), waitBeforeSending[v]);
+        MIDRONOME_BEGIN_UNCHECKED_CALLS // addEvent() only copies to the buffer reserved by the wrapper (see PluginProcessor.h)
+        if constexpr (Outputs::tempoControllers) {
+            if (v == BPM) {
+                // Bitwig seems to be the only DAW not transmitting the PitchWheel below but it will transmit the CC messages...
+                midiMessages.addEvent(juce::MidiMessage::controllerEvent(12, 85, newValue / 128), waitBeforeSending[v]);
+                midiMessages.addEvent(juce::MidiMessage::controllerEvent(12, 86, newValue % 128), waitBeforeSending[v]);
+            }
+            else {
+                midiMessages.addEvent(juce::MidiMessage::controllerEvent(12, 90, newValue), waitBeforeSending[v]);
+            }
         }
         
         if (v == BEATS_PER_BAR)
@@ -402,72 +746,607 @@ void MidronomeAudioProcessor::sendMidiToHost(values_type_t v, int newValue, int
         
         if (newValue <= 0x3FFF) // max value is 14 bit long
             midiMessages.addEvent(juce::MidiMessage::pitchWheel(12, newValue), waitBeforeSending[v]);
+        MIDRONOME_END_UNCHECKED_CALLS
         
         waitBeforeSending[v] = 0;
     }
     // else waitBeforeSending[v] == 0 -> we do nothing
 }
 
+// called for each tick of the 24ppq grid (not the extra ticks of x/8 time signatures), once lastTickNo is updated
+template <typename Outputs>
+void MidronomeProcessor<Outputs>::sendMidiClockTick(bool isOnGrid, int sample, juce::MidiBuffer& midiMessages) MIDRONOME_NONBLOCKING {
+    if (! Outputs::midiMessages || midiClockState == MidiClockState::stopped)
+        return;
+    
+    MIDRONOME_BEGIN_UNCHECKED_CALLS // like in sendMidiToHost()
+    // until the next 16th note the clock goes on while the receiver is stopped (it only keeps its tempo)
+    if (midiClockState != MidiClockState::running && isOnGrid && lastTickNo >= 0 && lastTickNo % 6 == 0) {
+        if (midiClockState == MidiClockState::waitingToStart && lastTickNo == 0) {
+            midiMessages.addEvent(juce::MidiMessage::midiStart(), sample);
+        }
+        else {
+            midiMessages.addEvent(juce::MidiMessage::songPositionPointer(static_cast<int>(std::min<int64_t>(lastTickNo / 6, 0x3FFF))), sample);
+            midiMessages.addEvent(juce::MidiMessage::midiContinue(), sample);
+        }
+        
+        midiClockState = MidiClockState::running;
+    }
+    
+    // after Start or Continue, the receiver plays from the start or song position on this clock
+    midiMessages.addEvent(juce::MidiMessage::midiClock(), sample);
+    MIDRONOME_END_UNCHECKED_CALLS
+}
+
+// called at the start of a block when the sync stops, or when the playhead has moved (to continue from the new position),
+// and at the loop seam (to continue from the loop start)
+template <typename Outputs>
+void MidronomeProcessor<Outputs>::stopMidiClock(bool isRelocating, juce::MidiBuffer& midiMessages, int sample) MIDRONOME_NONBLOCKING {
+    if constexpr (! Outputs::midiMessages)
+        return;
+    
+    MIDRONOME_BEGIN_UNCHECKED_CALLS // like in sendMidiToHost()
+    if (midiClockState == MidiClockState::running)
+        midiMessages.addEvent(juce::MidiMessage::midiStop(), sample);
+    MIDRONOME_END_UNCHECKED_CALLS
+    
+    if (isRelocating && midiClockState != MidiClockState::stopped)
+        midiClockState = MidiClockState::waitingToContinue;
+    else if (!isRelocating)
+        midiClockState = MidiClockState::stopped;
+}
+
 
 
-#define TICK_HEIGHT         0.9f
+//==============================================================================
+// the host position for this block: hosts give none at times (before their transport first runs, or while rendering
+// offline), which is a stopped transport, and the values which are not finite, too far to be a real position, or the
+// time signatures like 0/4 are left out, as if the host did not give them - so nothing downstream divides by 0 or
+// converts a NaN or a huge value to an integer
+// the values are checked in the position given by the host, which is returned as is (the checks are cheap, copying the
+// position is not, and this runs for every block)
+template <typename Outputs>
+juce::Optional<juce::AudioPlayHead::PositionInfo> MidronomeProcessor<Outputs>::getHostPosition() const noexcept MIDRONOME_NONBLOCKING
+{
+    MIDRONOME_BEGIN_UNCHECKED_CALLS // the host's playhead: hosts give its position without blocking (RTSan checks they do)
+    auto* playHead = getPlayHead();
+    auto position = playHead != nullptr ? playHead->getPosition() : juce::Optional<juce::AudioPlayHead::PositionInfo>();
+    MIDRONOME_END_UNCHECKED_CALLS
+    if (!position.hasValue()) {
+        position = juce::AudioPlayHead::PositionInfo(); // a stopped transport
+        return position;
+    }
+    
+    auto& info = *position;
+    auto isValid = [] (juce::Optional<double> value) { return !value.hasValue() || (std::isfinite(*value) && std::abs(*value) <= maxHostPosition); };
+    
+    if (!isValid(info.getBpm()))
+        info.setBpm({});
+    if (!isValid(info.getPpqPosition()))
+        info.setPpqPosition({});
+    if (!isValid(info.getPpqPositionOfLastBarStart()))
+        info.setPpqPositionOfLastBarStart({});
+    if (!isValid(info.getTimeInSeconds()))
+        info.setTimeInSeconds({});
+    if (auto timeInSamples = info.getTimeInSamples(); timeInSamples.hasValue() && std::abs(static_cast<double>(*timeInSamples)) > maxHostPosition * 1.0e6)
+        info.setTimeInSamples({});
+    if (auto timeSig = info.getTimeSignature(); timeSig.hasValue() && (timeSig->numerator < 1 || timeSig->denominator < 1))
+        info.setTimeSignature({});
+    if (auto loopPoints = info.getLoopPoints(); loopPoints.hasValue() && !(isValid(loopPoints->ppqStart) && isValid(loopPoints->ppqEnd)))
+        info.setLoopPoints({});
+    
+    return position;
+}
+
 
 //==============================================================================
-// returns the current sample, 0 if not sending TickPulse, and updates currentlySendingTickPulse
-float MidronomeAudioProcessor::getCurrentTickPulseSample()
+// telemetry events (only copied to the ring buffer when a trace is being recorded)
+template <typename Outputs>
+void MidronomeProcessor<Outputs>::recordBlock(const juce::Optional<juce::AudioPlayHead::PositionInfo>& info, int totalNumSamples, uint16_t flags) noexcept
 {
-    static int idx = 0;
+    if (!telemetry.isRecording())
+        return;
     
-    if (!currentlySendingTickPulse)
-        return 0.0f;
+    if (info->getIsPlaying())
+        flags |= TelemetryRecorder::isPlaying;
+    if (info->getIsLooping())
+        flags |= TelemetryRecorder::isLooping;
+    if (hasSyncStarted)
+        flags |= TelemetryRecorder::hasSyncStarted;
     
-    idx++;
+    TelemetryRecorder::Event event;
+    event.ppqPos = info->getPpqPosition().orFallback(0.0);
+    event.bpm = info->getBpm().orFallback(0.0);
+    event.timeInSamples = info->getTimeInSamples().orFallback(-1);
+    event.tickNo = lastTickNo == invalidTickNo ? -1 : lastTickNo;
+    event.sampleOffset = totalNumSamples;
+    event.type = TelemetryRecorder::blockEvent;
+    event.flags = flags;
+    telemetry.push(event);
+}
+
+template <typename Outputs>
+void MidronomeProcessor<Outputs>::recordTick(const juce::Optional<juce::AudioPlayHead::PositionInfo>& info, int64_t tickSample, double tickPpqPos, uint16_t flags) noexcept
+{
+    if (!telemetry.isRecording())
+        return;
     
-    if (idx < 4) {
-        return ((static_cast<float>(idx)*TICK_HEIGHT)/4.0f);
+    TelemetryRecorder::Event event;
+    event.ppqPos = tickPpqPos;
+    event.bpm = info->getBpm().orFallback(0.0);
+    event.timeInSamples = info->getTimeInSamples().orFallback(-1);
+    event.tickNo = lastTickNo == invalidTickNo ? -1 : lastTickNo;
+    event.sampleOffset = static_cast<int32_t>(tickSample);
+    event.type = TelemetryRecorder::tickEvent;
+    event.flags = flags | TelemetryRecorder::isPlaying | TelemetryRecorder::hasSyncStarted;
+    telemetry.push(event);
+}
+
+
+//==============================================================================
+// returns the first sample (from fromSample) at or after the next bar start, the bars being every barLength quarter notes
+// from lastBarPpqPos (before or after it), and sets barPpqPos to the position of that bar - a bar up to maxLateSamples
+// before fromSample starts the sync at fromSample
+// returns a sample >= timeline.numSamples if the sync does not start in this block
+template <typename Outputs>
+int64_t MidronomeProcessor<Outputs>::findSyncStartSample(const BlockTimeline& timeline, int64_t fromSample, double lastBarPpqPos, double barLength, double maxLateSamples, double& barPpqPos) const
+{
+    auto fromPpqPos = timeline.getPpqPosAt(fromSample) - maxLateSamples*timeline.dppqPerSample;
+    barPpqPos = lastBarPpqPos + std::ceil((fromPpqPos - lastBarPpqPos) / barLength) * barLength;
+    return timeline.getFirstSampleReaching(barPpqPos, fromSample);
+}
+
+
+//==============================================================================
+// returns the sample (from fromSample) where the next tick must be sent, and sets extraTickInTimeSig8 if it is the extra tick of x/8 time sig
+// tickPpqPos is set to the ppq position of that tick on the 24ppq grid, or -1 if it is not on the grid (forced by maxSamplesNumBetweenTicks)
+// returns a sample >= timeline.numSamples if there is no tick to send in this block
+template <typename Outputs>
+int64_t MidronomeProcessor<Outputs>::findNextTickSample(const BlockTimeline& timeline, int64_t fromSample, int64_t lastTickSample, bool timeSigIn8, double maxLateSamples, bool& extraTickInTimeSig8, double& tickPpqPos) const
+{
+    double errorRange = maxLateSamples*timeline.dppqPerSample; // usually 20 samples error range because of rounding and samples not "landing" exactly on a tick
+    
+    // we do not send a tick if it will give a tempo > 400bpm, and we make sure to send one to avoid tempo < 30bpm
+    auto earliestSample = std::max(fromSample, lastTickSample + minSamplesNumBetweenTicks);
+    auto latestSample = std::max(fromSample, lastTickSample + maxSamplesNumBetweenTicks);
+    int64_t tickSample;
+    
+    extraTickInTimeSig8 = false;
+    
+    if (lastTickNo != invalidTickNo) { // if we have a valid last tick position, we send a tick as soon as there is 1 (or more) tick between current and last tick
+        tickPpqPos = static_cast<double>(lastTickNo + 1) / 24.0;
+        tickSample = timeline.getFirstSampleReaching(tickPpqPos, earliestSample);
+        
+        if (timeSigIn8 && !isExtraTickSent) { // in time signatures in x/8 we send twice as many ticks
+            auto halfTickPpqPos = (static_cast<double>(lastTickNo) + 0.5) / 24.0;
+            auto halfTickSample = timeline.getFirstSampleReaching(halfTickPpqPos, earliestSample);
+            
+            // both can be already passed when catching up, and then the extra tick comes first
+            if (halfTickSample <= tickSample && timeline.getPpqPosAt(halfTickSample) - halfTickPpqPos < errorRange) {
+                tickSample = halfTickSample;
+                tickPpqPos = halfTickPpqPos;
+                extraTickInTimeSig8 = true;
+            }
+        }
     }
+    else { // if we do not have a valid last tick (sync just started, or playhead has moved), we wait to be close enough to a tick
+        auto tickPos = timeline.getPpqPosAt(earliestSample)*24.0;
+        
+        if (tickPos - floor(tickPos) < errorRange*24.0) {
+            tickPpqPos = floor(tickPos) / 24.0;
+            tickSample = earliestSample;
+        }
+        else {
+            tickPpqPos = (floor(tickPos) + 1.0) / 24.0;
+            tickSample = timeline.getFirstSampleReaching(tickPpqPos, earliestSample);
+        }
+    }
+    
+    if (latestSample < tickSample) {
+        tickSample = latestSample;
+        tickPpqPos = -1.0;
+        extraTickInTimeSig8 = false;
+    }
+    
+    return tickSample;
+}
+
+
+//==============================================================================
+// returns the phase of the pulse to send at tickSample, i.e. how far (in 1/numTickPulsePhases of a sample) before
+// tickSample the tick exactly is - 0 without subSampleTicks, or if the tick is late anyway (sync start, forced tick...)
+template <typename Outputs>
+int MidronomeProcessor<Outputs>::getTickPulsePhase(const BlockTimeline& timeline, int64_t tickSample, double tickPpqPos) const
+{
+    if (!subSampleTicks || tickPpqPos < 0.0)
+        return 0;
+    
+    auto fraction = static_cast<double>(tickSample) - timeline.getExactSampleAt(tickPpqPos);
+    if (fraction <= 0.0 || fraction >= 1.0)
+        return 0;
+    
+    return std::min(juce::roundToInt(fraction * numTickPulsePhases), numTickPulsePhases - 1);
+}
+
+
+//==============================================================================
+// renders the tick pulse currently being sent (if any) from startSample in numChannels channels, and returns the
+// sample where it ends (the pulse continues in the next block if it does not end in this one)
+// the buffer has been cleared, so the pulse is written directly in each output channel and nothing else is touched
+template <typename Outputs>
+template <typename SampleType>
+int64_t MidronomeProcessor<Outputs>::renderTickPulse(PulseState& pulse, juce::AudioBuffer<SampleType>& buffer, int firstChannel, int numChannels, int64_t startSample) MIDRONOME_NONBLOCKING
+{
+    auto totalNumSamples = buffer.getNumSamples();
+    
+    if (! Outputs::audioPulses || !pulse.isBeingSent || startSample >= totalNumSamples)
+        return startSample;
     
-    int samplesBeforeEnd = tickPulseLength - idx;
+    auto numSamples = std::min(pulse.length - pulse.pos, totalNumSamples - static_cast<int>(startSample));
+    auto lastChannel = std::min(firstChannel + numChannels, buffer.getNumChannels());
     
-    if (samplesBeforeEnd <= 0) {
-        currentlySendingTickPulse = false;
-        idx = 0;
-        return 0.0f;
+    if (firstChannel < lastChannel) {
+        auto* shape = pulse.shape + pulse.pos;
+        auto* output = buffer.getWritePointer(firstChannel, static_cast<int>(startSample));
+        
+        MIDRONOME_BEGIN_UNCHECKED_CALLS // vector multiplies and memcpys
+        if constexpr (std::is_same<SampleType, float>::value) {
+            juce::FloatVectorOperations::copyWithMultiply(output, shape, pulse.gain, numSamples);
+        }
+        else { // computed in single precision too, so both processBlock output exactly the same values
+            for (auto i = 0; i < numSamples; i++)
+                output[i] = static_cast<SampleType>(pulse.gain * shape[i]);
+        }
+        
+        for (auto ch = firstChannel + 1 ; ch < lastChannel ; ch++)
+            juce::FloatVectorOperations::copy(buffer.getWritePointer(ch, static_cast<int>(startSample)), output, numSamples);
+        MIDRONOME_END_UNCHECKED_CALLS
     }
     
-    if (samplesBeforeEnd < 15)
-        return ((static_cast<float>(samplesBeforeEnd)*TICK_HEIGHT)/15.0f);
+    pulse.pos += numSamples;
+    
+    if (pulse.pos >= pulse.length) {
+        pulse.isBeingSent = false;
+        pulse.pos = 0;
+    }
+    
+    return startSample + numSamples;
+}
+
+
+//==============================================================================
+// renders the LTC of the host time (with the lookahead if any) on the "Timecode" bus while playing - it does not depend on the tempo
+template <typename Outputs>
+template <typename SampleType>
+void MidronomeProcessor<Outputs>::renderTimecode(const juce::Optional<juce::AudioPlayHead::PositionInfo>& info, juce::AudioBuffer<SampleType>& buffer) MIDRONOME_NONBLOCKING
+{
+    if (! Outputs::audioPulses || timecodeChannel < 0 || timecodeChannel >= buffer.getNumChannels())
+        return;
+    
+    auto timeInSamples = info->getTimeInSamples();
+    if (!timeInSamples.hasValue() && info->getTimeInSeconds().hasValue())
+        timeInSamples = static_cast<int64_t>(std::llround(*info->getTimeInSeconds() * sampleRate));
     
-    return TICK_HEIGHT;
+    auto startTime = timeInSamples.orFallback(-1) + lookaheadSamples;
+    if (!info->getIsPlaying() || !timeInSamples.hasValue() || startTime < 0) { // the buffer has been cleared
+        ltcEncoder.reset();
+        return;
+    }
+    
+    ltcEncoder.render(startTime, buffer.getWritePointer(timecodeChannel), buffer.getNumSamples());
 }
 
 
 //==============================================================================
-bool MidronomeAudioProcessor::hasEditor() const
+// sends the pulses of each enabled clock output channel on its own grid, from fromSample (where the sync is running)
+// the pulse positions are computed from the block timeline (see ClockOutput::getPulsePpqPos), so swing, offsets and
+// divisions cost nothing more than straight pulses
+// like the main ticks, the first pulse after the sync starts or the playhead moves can be up to maxLateSamples late, and
+// the pulses past the loop end are the ones from the loop start, on the wrapped timeline from the seam
+template <typename Outputs>
+template <typename SampleType>
+void MidronomeProcessor<Outputs>::renderClockOutputs(const BlockTimeline& blockTimeline, const LoopSeam& seam, juce::AudioBuffer<SampleType>& buffer, int64_t fromSample, double maxLateSamples) MIDRONOME_NONBLOCKING
 {
+    if constexpr (! Outputs::audioPulses)
+        return;
+    
+    for (auto i = 0; i < numClockChannels; i++) {
+        auto& output = clockOutputs[static_cast<size_t>(i)];
+        auto channel = firstClockChannel + i;
+        auto lastPulseSample = -output.samplesSinceLastPulse;
+        auto nextCandidate = std::max(renderTickPulse(output.pulse, buffer, channel, 1, 0), fromSample);
+        auto timeline = blockTimeline;
+        auto hasCrossedSeam = false;
+        
+        // from the seam on, the pulses continue from the first one at the loop start
+        auto crossSeam = [&] (double offsetPpq)
+        {
+            timeline = seam.wrapped;
+            hasCrossedSeam = true;
+            if (output.isSynced) {
+                output.lastPulseNo = static_cast<int64_t>(std::floor((seam.loopStartPpqPos - offsetPpq) * output.ppqn / output.divide)) - 3;
+                while (output.getPulsePpqPos(output.lastPulseNo + 1, offsetPpq) < seam.loopStartPpqPos - LoopSeam::tolerancePpq)
+                    output.lastPulseNo++;
+            }
+        };
+        
+        if (hasSyncStarted) {
+            auto offsetPpq = output.offsetTicks/24.0 + output.offsetMs*0.001*sampleRate*timeline.dppqPerSample;
+            auto samplesPerStep = static_cast<double>(output.divide) / (timeline.dppqPerSample * static_cast<double>(output.ppqn));
+            
+            while (nextCandidate < timeline.numSamples) {
+                auto pulseNo = output.lastPulseNo + 1;
+                
+                if (!output.isSynced) { // we wait to be close enough to a pulse, but never send the same one twice
+                    auto fromPpqPos = timeline.getPpqPosAt(nextCandidate) - maxLateSamples*timeline.dppqPerSample;
+                    pulseNo = static_cast<int64_t>(std::floor((fromPpqPos - offsetPpq) * output.ppqn / output.divide)) - 2;
+                    while (output.getPulsePpqPos(pulseNo, offsetPpq) < fromPpqPos)
+                        pulseNo++;
+                    if (static_cast<double>(nextCandidate - lastPulseSample) < 0.25*samplesPerStep)
+                        pulseNo++;
+                }
+                
+                auto pulsePpqPos = output.getPulsePpqPos(pulseNo, offsetPpq);
+                auto pulseSample = timeline.getFirstSampleReaching(pulsePpqPos, nextCandidate);
+                
+                if (!hasCrossedSeam && pulseSample >= seam.wrapSample && (seam.isAfterLoopEnd(pulsePpqPos) || !output.isSynced)) {
+                    crossSeam(offsetPpq);
+                    nextCandidate = std::max(nextCandidate, seam.wrapSample);
+                    continue;
+                }
+                
+                if (pulseSample >= timeline.numSamples)
+                    break;
+                
+                output.lastPulseNo = pulseNo;
+                output.isSynced = true;
+                lastPulseSample = pulseSample;
+                startTickPulse(output.pulse, getTickPulsePhase(timeline, pulseSample, pulsePpqPos));
+                nextCandidate = renderTickPulse(output.pulse, buffer, channel, 1, pulseSample);
+            }
+            
+            if (seam.isInBlock() && !hasCrossedSeam) // no pulse to send until the seam
+                crossSeam(offsetPpq);
+        }
+        
+        output.samplesSinceLastPulse = timeline.numSamples - lastPulseSample;
+    }
+}
+
+
+
+//==============================================================================
+// computes once the ramps of the tick pulse, the pulse being rendered with the length and height of the parameters: a 4 samples
+// attack ramp, then a 15 samples release ramp back to 0 (tickPulse.release[k] is the value k samples before the end of the pulse)
+// they are followed by the ramps of subSampleTicks, computed for each phase, i.e. with the edge starting phase/numTickPulsePhases
+// of a sample before the first sample, and with raised cosine ramps so the edge is band-limited and its shape is the same
+// whatever the phase: the attack crosses half of the pulse height exactly 2 samples after the tick, at any sample rate
+// they do not depend on the parameters, so changing those never rebuilds them
+template <typename Outputs>
+void MidronomeProcessor<Outputs>::buildTickPulseTable()
+{
+    auto tableSize = static_cast<size_t>((1 + numTickPulsePhases) * tickPulseRampLength);
+    tickPulse.attack.realloc(tableSize);
+    tickPulse.release.realloc(tableSize);
+    
+    for (auto i = 0; i < tickPulseRampLength; i++) {
+        tickPulse.attack[i] = i < 3 ? static_cast<float>(i + 1)/4.0f : 1.0f;
+        tickPulse.release[i] = i < 15 ? static_cast<float>(i)/15.0f : 1.0f;
+    }
+    
+    auto raisedCosine = [] (double x) { return 0.5 - 0.5*std::cos(juce::MathConstants<double>::pi * juce::jlimit(0.0, 1.0, x)); };
+    
+    for (auto phase = 0; phase < numTickPulsePhases; phase++) {
+        auto* attack = tickPulse.attack.get() + (1 + phase)*tickPulseRampLength;
+        auto* release = tickPulse.release.get() + (1 + phase)*tickPulseRampLength;
+        auto fraction = static_cast<double>(phase) / static_cast<double>(numTickPulsePhases);
+        
+        for (auto i = 0; i < tickPulseRampLength; i++) {
+            attack[i] = static_cast<float>(raisedCosine((static_cast<double>(i) + fraction) / 4.0)); // i samples after the tick
+            release[i] = static_cast<float>(raisedCosine((static_cast<double>(i) - fraction) / 15.0));
+        }
+    }
+    
+    tickPulse.maxLength = juce::roundToInt(maxPulseLengthMs * static_cast<float>(tickPulse.samplesPerMs));
+    tickPulse.shapes.realloc(static_cast<size_t>(2 * (1 + numTickPulsePhases) * tickPulse.maxLength));
+    tickPulse.shapesLength[0] = tickPulse.shapesLength[1] = 0; // built by the first block
+    tickPulse.currentShapes = 0;
+}
+
+// builds the pulses of the current length into the set no pulse being sent uses, then makes it the current one: called
+// by the audio thread when the length changes, so rendering a pulse is a copy with its gain instead of 2 lookups and
+// 2 multiplies per sample. A pulse started before the previous change may still use the other set, which is then
+// built at the next block: a pulse lasts 2ms at most, so it is ended by then with any usual block size
+template <typename Outputs>
+void MidronomeProcessor<Outputs>::buildTickPulseShapes() noexcept
+{
+    auto setSize = (1 + numTickPulsePhases) * tickPulse.maxLength;
+    auto next = 1 - tickPulse.currentShapes;
+    auto* set = tickPulse.shapes.get() + next*setSize;
+    
+    auto isSentFromSet = [set, setSize] (const PulseState& pulse) { return pulse.isBeingSent && pulse.shape >= set && pulse.shape < set + setSize; };
+    if (isSentFromSet(tickPulse.state))
+        return;
+    for (const auto& output : clockOutputs)
+        if (isSentFromSet(output.pulse))
+            return;
+    
+    auto length = tickPulse.length;
+    for (auto ramps = 0; ramps <= numTickPulsePhases; ramps++) {
+        const auto* attack = tickPulse.attack.get() + ramps*tickPulseRampLength;
+        const auto* release = tickPulse.release.get() + ramps*tickPulseRampLength;
+        auto* shape = set + ramps*tickPulse.maxLength;
+        
+        for (auto pos = 0; pos < length; pos++)
+            shape[pos] = attack[std::min(pos, tickPulseRampLength - 1)] * release[std::min(length - 1 - pos, tickPulseRampLength - 1)];
+    }
+    
+    tickPulse.shapesLength[next] = length;
+    tickPulse.currentShapes = next;
+}
+
+// starts sending a pulse with the current length, and the height and polarity of the parameters at this tick: they are
+// read for each pulse, so an automation of them applies from the first tick after it, even in the middle of a block
+template <typename Outputs>
+void MidronomeProcessor<Outputs>::startTickPulse(PulseState& pulse, int phase) noexcept
+{
+    auto ramps = subSampleTicks ? 1 + phase : 0;
+    const float* shape = nullptr; // no pulses without the audio outputs
+    auto gain = 0.0f;
+    
+    if constexpr (Outputs::audioPulses) {
+        shape = tickPulse.shapes.get() + (tickPulse.currentShapes*(1 + numTickPulsePhases) + ramps)*tickPulse.maxLength;
+        gain = pulseHeightParameter->load(std::memory_order_relaxed);
+        if (invertPulsesParameter->load(std::memory_order_relaxed) >= 0.5f)
+            gain = -gain;
+    }
+    
+    // the length of the current pulses, which is the parameter's unless they could not be built yet
+    pulse = { phase, ramps, 0, tickPulse.shapesLength[tickPulse.currentShapes], gain, true, shape };
+}
+
+
+//==============================================================================
+// loads the parameters at the start of a block when they have changed since the previous one (see parameterChanged):
+// ticks and pulses starting in this block use these values (but the pulse height and polarity, see startTickPulse)
+template <typename Outputs>
+void MidronomeProcessor<Outputs>::updateParameters() noexcept
+{
+    // cleared before the values are loaded, so a change made while they are loaded is loaded again in the next block
+    if (parametersChanged.load(std::memory_order_relaxed) && parametersChanged.exchange(false, std::memory_order_acquire))
+        loadParameters();
+    
+    if constexpr (Outputs::audioPulses)
+        if (tickPulse.length != tickPulse.shapesLength[tickPulse.currentShapes])
+            buildTickPulseShapes();
+}
+
+template <typename Outputs>
+void MidronomeProcessor<Outputs>::loadParameters() noexcept
+{
+    if constexpr (Outputs::audioPulses) {
+        tickPulse.length = juce::roundToInt(pulseLengthParameter->load(std::memory_order_relaxed) * static_cast<float>(tickPulse.samplesPerMs));
+        subSampleTicks = subSampleTicksParameter->load(std::memory_order_relaxed) >= 0.5f;
+        
+        for (auto i = 0; i < numClockOutputs; i++) {
+            auto& output = clockOutputs[static_cast<size_t>(i)];
+            const auto& outputParameters = clockOutputParameters[static_cast<size_t>(i)];
+            auto ppqn = juce::roundToInt(outputParameters.ppqn->load(std::memory_order_relaxed));
+            auto divide = juce::roundToInt(outputParameters.divide->load(std::memory_order_relaxed));
+            
+            if (ppqn != output.ppqn || divide != output.divide) { // its pulse numbers are on another grid now: it starts again on the next pulse of the new one
+                output.ppqn = ppqn;
+                output.divide = divide;
+                output.isSynced = false;
+            }
+            
+            // the pulses move on the same grid: the next one is sent at its new position (right away if it is already passed)
+            output.swing = static_cast<double>(outputParameters.swing->load(std::memory_order_relaxed)) / 100.0;
+            output.offsetTicks = static_cast<double>(outputParameters.offsetTicks->load(std::memory_order_relaxed));
+            output.offsetMs = static_cast<double>(outputParameters.offsetMs->load(std::memory_order_relaxed));
+        }
+        
+        auto frameRate = static_cast<LtcEncoder::FrameRate>(juce::roundToInt(timecodeFrameRateParameter->load(std::memory_order_relaxed)));
+        if (frameRate != ltcEncoder.getFrameRate())
+            ltcEncoder.setFrameRate(frameRate);
+    }
+    
+    tickOffsetSamples = juce::roundToInt(tickOffsetParameter->load(std::memory_order_relaxed) * 0.001 * sampleRate);
+    minSyncBpm = static_cast<double>(minTempoParameter->load(std::memory_order_relaxed));
+    maxSyncBpm = std::max(minSyncBpm, static_cast<double>(maxTempoParameter->load(std::memory_order_relaxed)));
+    
+    if constexpr (Outputs::midiMessages)
+        midiClockOutput = midiClockOutputParameter->load(std::memory_order_relaxed) >= 0.5f;
+    
+   #if JucePlugin_WantsMidiInput
+    auto shouldFollowMidiClock = midiClockInputParameter->load(std::memory_order_relaxed) >= 0.5f;
+    if (shouldFollowMidiClock != midiClockInput) { // the transport jumps from the host's to the clock's, or back
+        midiClockInput = shouldFollowMidiClock;
+        midiClockFollower.reset();
+    }
+   #endif
+    
+    latencyCompensation = static_cast<LatencyCompensation>(juce::roundToInt(latencyCompensationParameter->load(std::memory_order_relaxed)));
+    latencyCompensationMs = static_cast<double>(latencyCompensationMsParameter->load(std::memory_order_relaxed));
+    lookaheadSamples = latencyCompensation == LatencyCompensation::lookahead ? juce::roundToInt(latencyCompensationMs * 0.001 * sampleRate) : 0;
+    
+    // ticks will always be sent within these limits (with a margin), even if the host tempo is not constant during the block
+    minSamplesNumBetweenTicks = static_cast<int64_t>(sampleRate / ( ((maxSyncBpm + 0.2)*24.0)/60.0 ));
+    maxSamplesNumBetweenTicks = static_cast<int64_t>(sampleRate / ( ((minSyncBpm - 0.1)*24.0)/60.0 ));
+}
+
+
+template <typename Outputs>
+void MidronomeProcessor<Outputs>::updateReportedLatency(double sr)
+{
+    auto mode = static_cast<LatencyCompensation>(juce::roundToInt(latencyCompensationParameter->load()));
+    auto milliseconds = static_cast<double>(latencyCompensationMsParameter->load());
+    setLatencySamples(mode == LatencyCompensation::reportToHost ? juce::roundToInt(milliseconds * 0.001 * sr) : 0);
+}
+
+// called on the thread which changed the parameter, often the audio thread when the host automates it: the audio thread
+// reloads the parameters from the next block, and the latency is reported from the message thread
+template <typename Outputs>
+void MidronomeProcessor<Outputs>::parameterChanged(const juce::String& parameterID, float)
+{
+    parametersChanged.store(true, std::memory_order_release);
+    
+    if (parameterID == "latencyCompensation" || parameterID == "latencyCompensationMs")
+        triggerAsyncUpdate();
+}
+
+template <typename Outputs>
+void MidronomeProcessor<Outputs>::handleAsyncUpdate()
+{
+    updateReportedLatency(getSampleRate());
+}
+
+
+//==============================================================================
+template <typename Outputs>
+bool MidronomeProcessor<Outputs>::hasEditor() const
+{
+   #if MIDRONOME_HEADLESS
+    return false; // headless build of the processor (see CMakeLists.txt)
+   #else
     return true; // (change this to false if you choose to not supply an editor)
+   #endif
 }
 
-juce::AudioProcessorEditor* MidronomeAudioProcessor::createEditor()
+template <typename Outputs>
+juce::AudioProcessorEditor* MidronomeProcessor<Outputs>::createEditor()
 {
-    return new MidronomeAudioProcessorEditor (*this);
+   #if MIDRONOME_HEADLESS
+    return nullptr;
+   #else
+    return createMidronomeEditor (*this);
+   #endif
 }
 
 //==============================================================================
-void MidronomeAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
+template <typename Outputs>
+void MidronomeProcessor<Outputs>::getStateInformation (juce::MemoryBlock& destData)
 {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
+    auto state = parameters.copyState();
+    std::unique_ptr<juce::XmlElement> xml (state.createXml());
+    copyXmlToBinary (*xml, destData);
 }
 
-void MidronomeAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
+template <typename Outputs>
+void MidronomeProcessor<Outputs>::setStateInformation (const void* data, int sizeInBytes)
 {
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
+    std::unique_ptr<juce::XmlElement> xmlState (getXmlFromBinary (data, sizeInBytes));
+    
+    if (xmlState.get() != nullptr && xmlState->hasTagName (parameters.state.getType())) {
+        parameters.replaceState (juce::ValueTree::fromXml (*xmlState));
+        updateReportedLatency(getSampleRate()); // 0 before the first prepareToPlay, which reports it again
+    }
 }
 
 //==============================================================================
+// only the outputs of this target are compiled (see SyncOutputs.h)
+template class MidronomeProcessor<PluginOutputs>;
+
 // This creates new instances of the plugin..
 juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 {
@@ -26,19 +26,32 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "LtcEncoder.h"
+#include "MidiClockFollower.h"
+#include "Nonblocking.h"
+#include "SyncOutputs.h"
+#include "TelemetryRecorder.h"
+#include "TimingDiagnostics.h"
+
+#include <array>
 
 //==============================================================================
 /**
+    The sync engine and plugin, for the outputs of a build target (see
+    SyncOutputs.h): MidronomeAudioProcessor is the one of the target being built.
 */
-class MidronomeAudioProcessor  : public juce::AudioProcessor
+template <typename Outputs>
+class MidronomeProcessor  : public juce::AudioProcessor
                             #if JucePlugin_Enable_ARA
                              , public juce::AudioProcessorARAExtension
                             #endif
+                            , private juce::AudioProcessorValueTreeState::Listener
+                            , private juce::AsyncUpdater
 {
 public:
     //==============================================================================
-    MidronomeAudioProcessor();
-    ~MidronomeAudioProcessor() override;
+    MidronomeProcessor();
+    ~MidronomeProcessor() override;
 
     //==============================================================================
     void prepareToPlay (double sr, int samplesPerBlock) override;
@@ -47,8 +60,11 @@ public:
    #ifndef JucePlugin_PreferredChannelConfigurations
     bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
    #endif
+    static constexpr int maxMainOutputChannels = 8; // the tick pulse is written in each of them
 
-    void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) MIDRONOME_NONBLOCKING override;
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) MIDRONOME_NONBLOCKING override;
+    bool supportsDoublePrecisionProcessing() const override;
 
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
@@ -73,126 +89,376 @@ public:
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
-private:
     //==============================================================================
-    float getCurrentTickPulseSample();
+    // the parameters of the plugin, which the host can automate (see createParameterLayout)
+    juce::AudioProcessorValueTreeState& getParameters() { return parameters; }
     
+    // the settings below are parameters too, so the host saves them with the session and the editor's settings view
+    // changes them: the setters set the parameter (e.g. for the bench), and like any parameter change it applies from
+    // the next block - the getters return the values of the last block (or of prepareToPlay)
     
-    //==============================================================================
-    double sampleRate;
-    float* outputData;
+    // places the edge of each tick pulse at the exact (sub-sample) position of the tick, with a band-limited
+    // attack, instead of starting the pulse on the first sample after the tick
+    void setSubSampleTicks(bool shouldBeEnabled) { setParameter("subSampleTicks", shouldBeEnabled ? 1.0f : 0.0f); }
+    bool hasSubSampleTicks() const { return subSampleTicks; }
     
-    bool hasSyncStarted;
-    bool currentlySendingTickPulse;
+    // the "Clock outputs" bus (disabled by default) has one pulse train per channel, each with its own resolution
+    // in pulses per quarter note (48, 4, 4 and 1 by default)
+    static constexpr int numClockOutputs = 4;
+    void setClockOutputPpqn(int output, int ppqn) { setParameter(getClockOutputParameterID(output, "Ppqn"), static_cast<float>(ppqn)); }
+    int getClockOutputPpqn(int output) const { return clockOutputs[static_cast<size_t>(output)].ppqn; }
     
-    int tickPulseLength;
+    // sends one pulse every `divide` pulses of the output resolution, e.g. 1ppqn divided by 4 is one pulse every 4 quarter notes
+    void setClockOutputDivide(int output, int divide) { setParameter(getClockOutputParameterID(output, "Divide"), static_cast<float>(divide)); }
+    int getClockOutputDivide(int output) const { return clockOutputs[static_cast<size_t>(output)].divide; }
     
-    int64_t expectedTimeInSamples; // to know if the playhead has been moved (manually or by looping)
-    int64_t lastTickNo; // last tick number, so we can check continuity and maintain 24 ticks per bar
-    int64_t samplesSinceLastTick; // to make sure we never send 2 ticks closer than minSamplesNumBetweenTicks
-    int64_t minSamplesNumBetweenTicks; // will be set to 6.25ms (=400bpm tick) in samples
-    int64_t maxSamplesNumBetweenTicks; // will be set to 83.3ms (=30bpm tick) in samples
+    // delays every second pulse of the output: 0.5 is straight, 0.66 is a triplet shuffle, up to 0.75
+    void setClockOutputSwing(int output, double swing) { setParameter(getClockOutputParameterID(output, "Swing"), static_cast<float>(swing * 100.0)); }
+    double getClockOutputSwing(int output) const { return clockOutputs[static_cast<size_t>(output)].swing; }
     
-    //==============================================================================
-    typedef enum values_type {
-        BPM,
-        BEATS_PER_BAR
-    } values_type_t;
+    // moves the pulses of the output by a number of 24ppq ticks plus a number of milliseconds (negative to send them earlier)
+    // the milliseconds are converted at the tempo of each block
+    void setClockOutputOffset(int output, double ticks, double milliseconds) {
+        setParameter(getClockOutputParameterID(output, "OffsetTicks"), static_cast<float>(ticks));
+        setParameter(getClockOutputParameterID(output, "OffsetMs"), static_cast<float>(milliseconds));
+    }
+    double getClockOutputOffsetTicks(int output) const { return clockOutputs[static_cast<size_t>(output)].offsetTicks; }
+    double getClockOutputOffsetMs(int output) const { return clockOutputs[static_cast<size_t>(output)].offsetMs; }
     
-    void sendMidiToHost(values_type_t v, int newValue, int totalNumSamples, bool isPlaying, juce::MidiBuffer& midiMessages);
+    // sends all pulses earlier by the output latency of the audio interface, so the hardware follows the DAW grid:
+    // - reportToHost: the latency is reported with setLatencySamples(), and the host delays everything else (plugin
+    //   delay compensation), which also takes care of transport starts and loops
+    // - lookahead: nothing is reported (for hosts without delay compensation, or to keep monitoring latency low), the
+    //   pulses are sent from the ppq position predicted that many milliseconds ahead - with the transport state and time
+    //   signature of the host's position, so the ticks sent ahead of a stop are sent again after it, and the extra tick
+    //   of x/8 right after a bar where the time signature changes follows the previous one if the lookahead passed it
+    enum class LatencyCompensation { off, reportToHost, lookahead };
+    void setLatencyCompensation(LatencyCompensation mode, double milliseconds) {
+        setParameter("latencyCompensation", static_cast<float>(mode));
+        setParameter("latencyCompensationMs", static_cast<float>(milliseconds));
+    }
+    LatencyCompensation getLatencyCompensation() const { return latencyCompensation; }
+    double getLatencyCompensationMs() const { return latencyCompensationMs; }
     
-    int lastValueSent[2];
-    int waitBeforeSending[2];
+    // also sends MIDI clock (at the exact sample of each tick), Start/Continue/Stop and Song Position Pointer to the host's
+    // MIDI output, so MIDI gear can follow the same ticks - when it is switched on while the sync runs, the gear joins
+    // on the next 16th note, and it is sent Stop when it is switched off
+    void setMidiClockOutput(bool shouldBeEnabled) { setParameter("midiClockOutput", shouldBeEnabled ? 1.0f : 0.0f); }
+    bool hasMidiClockOutput() const { return midiClockOutput; }
+    
+    // follows the MIDI clock, Start/Continue/Stop and Song Position Pointer sent to the plugin's MIDI input instead of
+    // the host transport (the host only gives the time signature): an upstream device clocks the pulses and MIDI
+    // messages through the DAW, without its jitter (see MidiClockFollower.h) - only in the targets which receive MIDI,
+    // the follower starts again from the next clock when it is switched on
+    void setMidiClockInput(bool shouldBeEnabled) { setParameter("midiClockInput", shouldBeEnabled ? 1.0f : 0.0f); }
+    bool hasMidiClockInput() const { return midiClockInput; }
+    const MidiClockFollower& getMidiClockFollower() const { return midiClockFollower; }
+    
+    // the "Timecode" bus (disabled by default) sends the SMPTE linear timecode of the host time while playing, for
+    // video and tape machines
+    void setTimecodeFrameRate(LtcEncoder::FrameRate frameRate) { setParameter("timecodeFrameRate", static_cast<float>(frameRate)); }
+    LtcEncoder::FrameRate getTimecodeFrameRate() const { return ltcEncoder.getFrameRate(); }
     
+    // blocks and ticks are recorded to a binary trace file while it is started (see TelemetryRecorder.h)
+    // it starts automatically in a new file of the MIDRONOME_TRACE_DIR directory if this environment variable is set
+    TelemetryRecorder& getTelemetry() { return telemetry; }
     
-#ifdef DEBUG
-    class DebugLogger {
-      public:
-        DebugLogger() {}
+    // timing statistics of the audio thread, for the editor's diagnostics view
+    TimingDiagnostics& getDiagnostics() { return diagnostics; }
+    
+    // the closest and furthest the ticks can be while the sync runs: a tick at the maximum and at the minimum tempo of
+    // the tempo range parameters, in samples at the sample rate of prepareToPlay()
+    int64_t getMinSamplesBetweenTicks() const { return minSamplesNumBetweenTicks; }
+    int64_t getMaxSamplesBetweenTicks() const { return maxSamplesNumBetweenTicks; }
+
+private:
+    //==============================================================================
+    // ppq position of each sample of the current block, to compute tick positions without going through each sample
+    // the tempo changes linearly during the block when the host is doing a tempo ramp (dppqSlope != 0)
+    struct BlockTimeline {
+        double startPpqPos;
+        double dppqPerSample; // at the start of the block
+        double dppqSlope; // change of dppqPerSample per sample
+        int numSamples;
         
-        void logBlockInfo(juce::Optional<juce::AudioPlayHead::PositionInfo>& info) {
-            if (nextBlockInfoLog < SIZE) {
-                blockInfoLogs[nextBlockInfoLog].set(info);
-                nextBlockInfoLog++;
-            }
+        // the same timeline, started `samples` later
+        BlockTimeline shiftedBy(double samples) const {
+            return { startPpqPos + samples*(dppqPerSample + 0.5*dppqSlope*samples), dppqPerSample + dppqSlope*samples, dppqSlope, numSamples };
         }
         
-        void logTickPulseSent(double tickPpqPos, int64_t currentTickNo, juce::Optional<juce::AudioPlayHead::PositionInfo>& info) {
-            if (nextTickLog < SIZE) {
-                tickSentLogs[nextTickLog].set(tickPpqPos, currentTickNo, info);
-                nextTickLog++;
-            }
+        double getPpqPosAt(int64_t sample) const {
+            auto s = static_cast<double>(sample);
+            return startPpqPos + s*(dppqPerSample + 0.5*dppqSlope*s);
         }
         
-        void reset() {
-            nextBlockInfoLog = 0;
-            nextTickLog = 0;
-            prevPlayingStatus = false;
+        // fractional sample at which ppqPos is reached (may be outside of the block, or infinite if the tempo ramp never reaches it)
+        double getExactSampleAt(double ppqPos) const {
+            auto delta = ppqPos - startPpqPos;
+            auto discriminant = dppqPerSample*dppqPerSample + 2.0*dppqSlope*delta;
+            if (discriminant < 0.0)
+                return std::numeric_limits<double>::infinity();
+            return 2.0*delta / (dppqPerSample + std::sqrt(discriminant)); // root of startPpqPos + s*(dppqPerSample + 0.5*dppqSlope*s) = ppqPos
         }
         
-        bool prevPlayingStatus;
-        
-        
-      private:
-        
-        class TickInfo {
-          public:
-            TickInfo() {}
+        // returns the first sample >= fromSample whose ppq position is >= ppqPos, or numSamples if it is not in this block
+        int64_t getFirstSampleReaching(double ppqPos, int64_t fromSample) const {
+            if (fromSample >= numSamples || getPpqPosAt(fromSample) >= ppqPos)
+                return fromSample;
+            if (getPpqPosAt(numSamples - 1) < ppqPos) // most blocks have no tick: this spares the square root below
+                return numSamples;
             
-            void set(double tickPpqPos, int64_t currentTickNo, juce::Optional<juce::AudioPlayHead::PositionInfo>& info) {
-                ppqPos = tickPpqPos;
-                tickNo = currentTickNo;
-                auto timeSig = info->getTimeSignature();
-                int beatsPerBar = 4;
-                if (timeSig.hasValue())
-                    beatsPerBar = (4 * timeSig->numerator) / (timeSig->denominator);
-                auto posInBar = ppqPos - info->getPpqPositionOfLastBarStart().orFallback(0.0);
-                if (posInBar > static_cast<double>(beatsPerBar))
-                    posInBar -= static_cast<double>(beatsPerBar);
-                tickPosInBar = static_cast<int>(floor(posInBar * 24.0));
-            }
+            auto exactSample = getExactSampleAt(ppqPos);
+            if (exactSample >= static_cast<double>(numSamples))
+                return numSamples;
             
-            double ppqPos;
-            int64_t tickNo;
-            int tickPosInBar;
-        };
+            auto sample = std::max(fromSample, static_cast<int64_t>(std::ceil(exactSample)));
+            while (sample > fromSample && getPpqPosAt(sample - 1) >= ppqPos) // rounding errors
+                sample--;
+            while (sample < numSamples && getPpqPosAt(sample) < ppqPos)
+                sample++;
+            return sample;
+        }
+    };
+    
+    // where the scheduling timeline of the block reaches the loop end when the host is looping: from wrapSample on, the grid
+    // continues from the loop start on `wrapped` (the same timeline moved back by the loop length, which is only back at
+    // the loop start from wrapSample on), so the ticks continue across the seam instead of waiting for a relocation
+    struct LoopSeam {
+        double loopStartPpqPos;
+        double loopEndPpqPos;
+        int64_t wrapSample; // > wrapped.numSamples if the timeline does not reach the loop end in this block
+        BlockTimeline wrapped;
         
-        class BlockInfo {
-          public:
-            BlockInfo() {}
-            
-            void set(juce::Optional<juce::AudioPlayHead::PositionInfo>& info) {
-                lastBarPpqPosition = info->getPpqPositionOfLastBarStart().orFallback(-999999.0);
-                ppqPosition = info->getPpqPosition().orFallback(-999999.0);
-                timeInSamples = info->getTimeInSamples().orFallback(-999999);
-                timeInSeconds = info->getTimeInSeconds().orFallback(-999999.0);
-                bpm = info->getBpm().orFallback(-999999.0);
-                isRecordingOrPlaying = 0;
-                if (info->getIsPlaying())
-                    isRecordingOrPlaying += 1;
-                if (info->getIsRecording())
-                    isRecordingOrPlaying += 10;
+        // ppq positions from the loop points, a tick that close to the loop end is the one at the loop start
+        static constexpr double tolerancePpq = 1.0e-6;
+        
+        static LoopSeam find(const BlockTimeline& timeline, bool isLooping, double loopStartPpqPos, double loopEndPpqPos) {
+            LoopSeam seam { loopStartPpqPos, loopEndPpqPos, std::numeric_limits<int64_t>::max(), timeline };
+            if (isLooping && timeline.getPpqPosAt(timeline.numSamples) >= loopEndPpqPos - tolerancePpq) {
+                seam.wrapSample = timeline.getFirstSampleReaching(loopEndPpqPos - tolerancePpq, 0);
+                seam.wrapped.startPpqPos -= loopEndPpqPos - loopStartPpqPos;
             }
-            
-          private:
-            double lastBarPpqPosition;
-            double ppqPosition;
-            int64_t timeInSamples;
-            double timeInSeconds;
-            double bpm;
-            int isRecordingOrPlaying; // 1 for playing, 10 for recording (11 for both)
-        };
+            return seam;
+        }
+        
+        bool isInBlock() const { return wrapSample <= wrapped.numSamples; }
+        bool isAfterLoopEnd(double ppqPos) const { return isInBlock() && ppqPos >= loopEndPpqPos - tolerancePpq; }
         
-        static const int SIZE = 512;
-        unsigned int nextBlockInfoLog;
-        unsigned int nextTickLog;
-        BlockInfo blockInfoLogs[SIZE];
-        TickInfo tickSentLogs[SIZE];
+        // the first tick of the 24ppq grid at or after the loop start
+        int64_t getFirstTickNo() const {
+            return static_cast<int64_t>(std::ceil((loopStartPpqPos - tolerancePpq) * 24.0));
+        }
+    };
+    
+    // the host position, without the values the sync cannot use (see getHostPosition)
+    static constexpr double maxHostPosition = 1.0e9; // in quarter notes or seconds, about 30 years
+    juce::Optional<juce::AudioPlayHead::PositionInfo> getHostPosition() const noexcept MIDRONOME_NONBLOCKING;
+    
+    int64_t findSyncStartSample(const BlockTimeline& timeline, int64_t fromSample, double lastBarPpqPos, double barLength, double maxLateSamples, double& barPpqPos) const;
+    int64_t findNextTickSample(const BlockTimeline& timeline, int64_t fromSample, int64_t lastTickSample, bool timeSigIn8, double maxLateSamples, bool& extraTickInTimeSig8, double& tickPpqPos) const;
+    int getTickPulsePhase(const BlockTimeline& timeline, int64_t tickSample, double tickPpqPos) const;
+    template <typename SampleType>
+    void processSamples(juce::AudioBuffer<SampleType>& buffer, juce::MidiBuffer& midiMessages) MIDRONOME_NONBLOCKING;
+    
+    // a tick pulse being sent on some output channels
+    struct PulseState {
+        int phase; // how far before its first sample the edge of the pulse is (see getTickPulsePhase)
+        int ramps; // which ramps of the tables are used: 0 for the plain ones, 1 + phase with subSampleTicks
+        int pos; // number of samples of this pulse already sent
+        int length; // the length and gain the pulse started with, so parameter changes never cut or change a pulse being sent
+        float gain;
+        bool isBeingSent;
+        const float* shape; // its samples at unit gain, from the first one (see TickPulse::shapes)
     };
     
-    DebugLogger LOGGER;
-#endif
+    template <typename SampleType>
+    int64_t renderTickPulse(PulseState& pulse, juce::AudioBuffer<SampleType>& buffer, int firstChannel, int numChannels, int64_t startSample) MIDRONOME_NONBLOCKING;
+    template <typename SampleType>
+    void renderTimecode(const juce::Optional<juce::AudioPlayHead::PositionInfo>& info, juce::AudioBuffer<SampleType>& buffer) MIDRONOME_NONBLOCKING;
+    template <typename SampleType>
+    void renderClockOutputs(const BlockTimeline& timeline, const LoopSeam& seam, juce::AudioBuffer<SampleType>& buffer, int64_t fromSample, double maxLateSamples) MIDRONOME_NONBLOCKING;
+    void buildTickPulseTable();
+    void buildTickPulseShapes() noexcept;
+    void startTickPulse(PulseState& pulse, int phase) noexcept;
+    
+    
+    //==============================================================================
+    double sampleRate;
+    
+    bool hasSyncStarted;
+    bool subSampleTicks;
+    
+    LatencyCompensation latencyCompensation;
+    double latencyCompensationMs;
+    int lookaheadSamples; // with LatencyCompensation::lookahead, from the parameters of the block
+    int loopPassOffset; // 1 when the predicted position has wrapped to the loop start but not the host's yet, -1 the other way round with a late tick offset
+    int catchUpSamples; // the sync started up to that late on a bar (the lookahead, or the MIDI clock acquisition), ticks are sent as soon as possible until they are back on the grid - 0 once they are
     
+    // with subSampleTicks, the pulse is pre-computed for this many positions of its edge between 2 samples (after the
+    // plain ramps, so the parameter can change while pulses are being sent)
+    static constexpr int numTickPulsePhases = 32;
     
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidronomeAudioProcessor)
+    // the ramps of the pulse are pre-computed, and a pulse of any length is the attack ramp times the release ramp
+    // (indexed by the number of samples before its end): each ramp table is this long, its last value being 1
+    static constexpr int tickPulseRampLength = 17; // 15 samples release ramp, plus up to 1 sample of phase, plus 1
+    
+    // state of the tick pulse being sent, owned by each instance (hosts may run several instances on parallel
+    // audio threads) and kept on its own cache line since the audio thread writes it for every pulse
+    struct alignas(64) TickPulse {
+        juce::HeapBlock<float> attack; // the ramps (see PulseState::ramps), computed in prepareToPlay
+        juce::HeapBlock<float> release;
+        
+        // 2 sets of the whole pulses of a length at unit gain, built from the ramps when the length changes (see
+        // buildTickPulseShapes): each set has the pulse of each ramps, maxLength samples apart, so rendering a pulse
+        // is a copy multiplied by its gain
+        juce::HeapBlock<float> shapes;
+        int maxLength; // of the pulse parameter, in samples
+        int shapesLength[2]; // of the pulses of each set, 0 until it is built
+        int currentShapes; // the set of the pulses starting now
+        
+        int samplesPerMs; // of pulse length: 48 at 44.1 and 48kHz, then doubled with the sample rate
+        int length; // length of the pulses starting in the current block, from the parameter
+        PulseState state; // the pulse sent on the main output
+    };
+    
+    static constexpr float maxPulseLengthMs = 2.0f;
+    
+    TickPulse tickPulse;
+    
+    int64_t expectedTimeInSamples; // to know if the playhead has been moved (other than by the loop wraps, see isLoopWrapExpected)
+    double previousBlockPpqPos; // to estimate the tempo slope during host tempo ramps
+    double expectedPpqPos; // where the host continues after the previous block, unless it moved
+    bool isLoopWrapExpected; // the host reached the loop end in the previous block, so it continues from expectedPpqPos minus the loop length
+    int previousBlockNumSamples; // 0 if the previous block cannot be used for that (not playing, playhead moved)
+    int64_t lastTickNo; // last tick number, so we can check continuity and maintain 24 ticks per bar
+    bool isExtraTickSent; // in x/8 time sig, the extra tick after lastTickNo was sent, so catching up does not send it again
+    static constexpr int64_t invalidTickNo = std::numeric_limits<int64_t>::min(); // -1 is the tick before a bar starting at 0
+    int64_t samplesSinceLastTick; // to make sure we never send 2 ticks closer than minSamplesNumBetweenTicks
+    int64_t minSamplesNumBetweenTicks; // a tick at the maximum tempo in samples, 6.25ms (=400bpm tick) by default
+    int64_t maxSamplesNumBetweenTicks; // a tick at the minimum tempo in samples, 83.3ms (=30bpm tick) by default
+    
+    // each channel of the "Clock outputs" bus follows the ppq grid at its own resolution, from the same timeline as the main ticks
+    struct ClockOutput {
+        int ppqn;
+        int divide;
+        double swing;
+        double offsetTicks;
+        double offsetMs;
+        
+        // ppq position of pulse pulseNo, offset by offsetPpq: pulses are paired, the second one of each pair is swung
+        double getPulsePpqPos(int64_t pulseNo, double offsetPpq) const {
+            auto step = static_cast<double>(divide) / static_cast<double>(ppqn);
+            auto pairStart = static_cast<double>(pulseNo - (pulseNo & 1)); // & 1 is also the parity of negative numbers
+            return (pairStart + ((pulseNo & 1) ? 2.0*swing : 0.0)) * step + offsetPpq;
+        }
+        
+        int64_t lastPulseNo; // can be negative with an offset, only valid if isSynced
+        bool isSynced; // false when the sync has not started, or the playhead moved
+        int64_t samplesSinceLastPulse;
+        PulseState pulse;
+    };
+    
+    std::array<ClockOutput, numClockOutputs> clockOutputs;
+    
+    //==============================================================================
+    juce::AudioProcessorValueTreeState parameters;
+    static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
+    
+    // the values of the parameters, cached in the constructor: the audio thread only loads these atomics (which never
+    // locks) in loadParameters(), at the start of the blocks after a parameter changed, except for the pulse height and
+    // polarity which startTickPulse() loads at each tick; then each pulse keeps the values it started with
+    std::atomic<float>* pulseLengthParameter; // nullptr without the audio outputs (see SyncOutputs.h)
+    std::atomic<float>* pulseHeightParameter;
+    std::atomic<float>* invertPulsesParameter;
+    std::atomic<float>* tickOffsetParameter;
+    std::atomic<float>* minTempoParameter;
+    std::atomic<float>* maxTempoParameter;
+    std::atomic<float>* subSampleTicksParameter;
+    std::atomic<float>* timecodeFrameRateParameter;
+    std::atomic<float>* latencyCompensationParameter;
+    std::atomic<float>* latencyCompensationMsParameter;
+    std::atomic<float>* midiClockOutputParameter; // nullptr without the MIDI messages
+    std::atomic<float>* midiClockInputParameter; // nullptr without the MIDI input
+    
+    struct ClockOutputParameters {
+        std::atomic<float>* ppqn;
+        std::atomic<float>* divide;
+        std::atomic<float>* swing; // in %
+        std::atomic<float>* offsetTicks;
+        std::atomic<float>* offsetMs;
+    };
+    
+    std::array<ClockOutputParameters, numClockOutputs> clockOutputParameters;
+    static constexpr int defaultClockOutputPpqn[numClockOutputs] = { 48, 4, 4, 1 }; // 48ppq, 4ppq (Volca/Korg sync), 16th notes, quarter notes
+    
+    // e.g. "clockOutput1Ppqn" for the ppqn of the first output
+    static juce::String getClockOutputParameterID(int output, const char* name);
+    
+    // sets a parameter from outside of the audio thread, if this target has it (see createParameterLayout)
+    void setParameter(const juce::String& parameterID, float value);
+    
+    // the output channels of the main, clock outputs and timecode buses, from the layout prepareToPlay was called with
+    int numMainChannels = 0;
+    int firstClockChannel = 0, numClockChannels = 0;
+    int timecodeChannel = -1;
+    
+    void updateParameters() noexcept;
+    void loadParameters() noexcept;
+    std::atomic<bool> parametersChanged { true }; // set by parameterChanged(), from any thread
+    
+    // the latency reported with LatencyCompensation::reportToHost is set outside of the audio thread: in prepareToPlay,
+    // when a state is restored, and asynchronously on the message thread when its parameters change
+    void updateReportedLatency(double sr);
+    void parameterChanged(const juce::String& parameterID, float newValue) override;
+    void handleAsyncUpdate() override;
+    
+    int tickOffsetSamples; // > 0 to send the ticks later, < 0 to send them earlier
+    double minSyncBpm, maxSyncBpm; // the sync runs within this tempo range
+    
+    LtcEncoder ltcEncoder;
+    
+    //==============================================================================
+    typedef enum values_type {
+        BPM,
+        BEATS_PER_BAR
+    } values_type_t;
+    
+    void sendMidiToHost(values_type_t v, int newValue, int totalNumSamples, bool isPlaying, juce::MidiBuffer& midiMessages) MIDRONOME_NONBLOCKING;
+    
+    int lastValueSent[2];
+    int waitBeforeSending[2];
+    
+    // MIDI clock: after the sync starts or the playhead moves, the receiver is started on the first tick on a 16th
+    // note, as the Song Position Pointer counts 16th notes
+    enum class MidiClockState { stopped, waitingToStart, waitingToContinue, running };
+    
+    bool midiClockOutput;
+    MidiClockState midiClockState;
+    
+    void sendMidiClockTick(bool isOnGrid, int sample, juce::MidiBuffer& midiMessages) MIDRONOME_NONBLOCKING;
+    
+    bool midiClockInput;
+    MidiClockFollower midiClockFollower;
+    void stopMidiClock(bool isRelocating, juce::MidiBuffer& midiMessages, int sample = 0) MIDRONOME_NONBLOCKING;
+    
+    // the events are added to the MIDI buffer of the plugin wrapper, which reserves 2048 bytes when it is prepared (VST3,
+    // AU and AAX): far more than we add in a block (9 bytes per event, a MIDI clock per tick plus up to 9 other events, so
+    // about 350 bytes in a 8192 samples block at 400bpm), so addEvent() never grows it on the audio thread - the bench's
+    // --alloc-guard checks it with a buffer reserved the same way
+    
+    
+    //==============================================================================
+    TelemetryRecorder telemetry;
+    TimingDiagnostics diagnostics;
+    
+    void recordBlock(const juce::Optional<juce::AudioPlayHead::PositionInfo>& info, int totalNumSamples, uint16_t flags) noexcept;
+    void recordTick(const juce::Optional<juce::AudioPlayHead::PositionInfo>& info, int64_t tickSample, double tickPpqPos, uint16_t flags) noexcept;
+    
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidronomeProcessor)
 };
+
+using MidronomeAudioProcessor = MidronomeProcessor<PluginOutputs>;
+
+// each target creates its own editor (in its PluginEditor.cpp)
+juce::AudioProcessorEditor* createMidronomeEditor (MidronomeAudioProcessor&);
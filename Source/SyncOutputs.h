@@ -0,0 +1,69 @@
+/*
+    ==============================================================================
+
+    This file is part of the Midronome plugin, a VST3/AU/AAX plugin for Digital
+    Audio Workstations (DAW) whose purpose is to synchronize DAWs with the
+    Midronome (more info on <https://www.midronome.com/>).
+
+    Copyright © 2023 - Simon Lasnier (Midronome ApS)
+
+    The Midronome plugin is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option) any
+    later version.
+
+    The Midronome plugin is distributed in the hope that it will be useful, but
+    WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+    details.
+
+    You should have received a copy of the GNU General Public License along with
+    the Midronome plugin. If not, see <https://www.gnu.org/licenses/>.
+
+    ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    What a build target of the plugin sends, as MidronomeProcessor's template
+    parameter: the code of the outputs a target does not have is compiled out.
+
+    - audioPulses: the 24ppq pulses, clock outputs and timecode (audio buses)
+    - midiMessages: the tempo and time signature messages to the Midronome over
+      USB, and MIDI clock
+    - tempoControllers: the tempo and time signature are also sent as CC, for
+      hosts which do not pass on the pitch wheel messages (Bitwig)
+*/
+struct AudioAndMidiOutputs  // VST3 and AAX "Midronome"
+{
+    static constexpr bool audioPulses = true;
+    static constexpr bool midiMessages = true;
+    static constexpr bool tempoControllers = true;
+};
+
+struct AudioPulsesOutputs   // AU "Midronome": an AU instrument does not send MIDI, "MidronomeMIDI" does
+{
+    static constexpr bool audioPulses = true;
+    static constexpr bool midiMessages = false;
+    static constexpr bool tempoControllers = false;
+};
+
+struct MidiMessagesOutputs  // AU "MidronomeMIDI", a MIDI effect
+{
+    static constexpr bool audioPulses = false;
+    static constexpr bool midiMessages = true;
+    static constexpr bool tempoControllers = false;
+};
+
+// the outputs of the target being built, from its plugin settings (JucePluginDefines.h or juce_add_plugin)
+#if JucePlugin_IsMidiEffect
+ using PluginOutputs = MidiMessagesOutputs;
+#elif JucePlugin_ProducesMidiOutput
+ using PluginOutputs = AudioAndMidiOutputs;
+#else
+ using PluginOutputs = AudioPulsesOutputs;
+#endif
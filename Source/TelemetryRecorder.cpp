@@ -0,0 +1,124 @@
+/*
+    ==============================================================================
+
+    This file is part of the Midronome plugin, a VST3/AU/AAX plugin for Digital
+    Audio Workstations (DAW) whose purpose is to synchronize DAWs with the
+    Midronome (more info on <https://www.midronome.com/>).
+
+    Copyright © 2023 - Simon Lasnier (Midronome ApS)
+
+    The Midronome plugin is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option) any
+    later version.
+
+    The Midronome plugin is distributed in the hope that it will be useful, but
+    WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+    details.
+
+    You should have received a copy of the GNU General Public License along with
+    the Midronome plugin. If not, see <https://www.gnu.org/licenses/>.
+
+    ==============================================================================
+*/
+
+#include "TelemetryRecorder.h"
+
+//==============================================================================
+// background thread emptying the ring buffer into the trace file
+class TelemetryRecorder::Writer  : public juce::Thread
+{
+public:
+    Writer(TelemetryRecorder& r, std::unique_ptr<juce::FileOutputStream> s)
+        : juce::Thread("Midronome telemetry"), recorder(r), stream(std::move(s)) {}
+
+    void run() override
+    {
+        while (!threadShouldExit()) {
+            recorder.writeAvailableEvents(*stream);
+            wait(20); // the ring holds ~80ms of events in the worst case (1 sample blocks)
+        }
+
+        recorder.writeAvailableEvents(*stream);
+        stream->flush();
+    }
+
+private:
+    TelemetryRecorder& recorder;
+    std::unique_ptr<juce::FileOutputStream> stream;
+};
+
+
+//==============================================================================
+TelemetryRecorder::TelemetryRecorder()
+{
+    events.allocate(capacity, true); // once and for all, so the audio thread never sees it change
+}
+
+TelemetryRecorder::~TelemetryRecorder()
+{
+    stopRecording();
+}
+
+//==============================================================================
+bool TelemetryRecorder::startRecording(const juce::File& traceFile)
+{
+    stopRecording();
+
+    traceFile.deleteFile();
+    auto stream = std::make_unique<juce::FileOutputStream>(traceFile);
+    if (stream->failedToOpen())
+        return false;
+
+    const uint32_t header[4] = { 0x5254444D /* "MDTR" */, formatVersion, static_cast<uint32_t>(sizeof(Event)), 0 };
+    stream->write(header, sizeof(header));
+
+    // nothing reads the ring while not recording, so we can skip what is left in it
+    readIndex.store(writeIndex.load(std::memory_order_acquire), std::memory_order_release);
+    lostEventsReported = lostEvents.load(std::memory_order_relaxed);
+
+    currentTraceFile = traceFile;
+    writer = std::make_unique<Writer>(*this, std::move(stream));
+    writer->startThread();
+
+    recording.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+void TelemetryRecorder::stopRecording()
+{
+    recording.store(false, std::memory_order_relaxed);
+
+    if (writer != nullptr) {
+        writer->stopThread(1000); // writes what is left in the ring before exiting
+        writer.reset();
+    }
+}
+
+//==============================================================================
+// writer thread only
+void TelemetryRecorder::writeAvailableEvents(juce::OutputStream& out)
+{
+    auto read = readIndex.load(std::memory_order_relaxed);
+    auto write = writeIndex.load(std::memory_order_acquire);
+
+    while (read != write) {
+        auto start = read & (capacity - 1);
+        auto num = std::min(write - read, capacity - start); // up to the end of the ring, then from its start
+        out.write(events.get() + start, num * sizeof(Event));
+        read += num;
+    }
+
+    readIndex.store(read, std::memory_order_release);
+
+    auto lost = lostEvents.load(std::memory_order_relaxed);
+    if (lost != lostEventsReported) {
+        Event overflow {};
+        overflow.type = overflowEvent;
+        overflow.timeInSamples = -1;
+        overflow.tickNo = static_cast<int64_t>(lost - lostEventsReported);
+        out.write(&overflow, sizeof(Event));
+        lostEventsReported = lost;
+    }
+}
@@ -0,0 +1,129 @@
+/*
+    ==============================================================================
+
+    This file is part of the Midronome plugin, a VST3/AU/AAX plugin for Digital
+    Audio Workstations (DAW) whose purpose is to synchronize DAWs with the
+    Midronome (more info on <https://www.midronome.com/>).
+
+    Copyright © 2023 - Simon Lasnier (Midronome ApS)
+
+    The Midronome plugin is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option) any
+    later version.
+
+    The Midronome plugin is distributed in the hope that it will be useful, but
+    WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+    details.
+
+    You should have received a copy of the GNU General Public License along with
+    the Midronome plugin. If not, see <https://www.gnu.org/licenses/>.
+
+    ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Records what the audio thread does (blocks received from the host, ticks sent)
+    into a wait-free single producer / single consumer ring buffer, which a
+    background thread writes to a binary trace file while recording.
+
+    The audio thread only copies the event into the ring and publishes it, so it
+    can stay on during real sessions. If the writer falls behind, events are
+    dropped (never waited for) and an overflowEvent in the trace says how many.
+
+    Trace file: a 16 bytes header ("MDTR", format version, sizeof(Event), 0 - as
+    uint32), followed by the Events as they are in memory (little endian).
+*/
+class TelemetryRecorder
+{
+public:
+    enum EventType : uint16_t {
+        prepareEvent = 1,   // prepareToPlay: bpm is the sample rate, sampleOffset the max block size
+        blockEvent = 2,     // start of a block: sampleOffset is its number of samples, tickNo the last tick number
+        tickEvent = 3,      // a tick is sent: ppqPos is its position on the 24ppq grid, sampleOffset its sample in the block
+        overflowEvent = 4   // tickNo events were lost because the ring was full
+    };
+
+    enum Flags : uint16_t {
+        isPlaying = 1 << 0,
+        isLooping = 1 << 1,
+        hasSyncStarted = 1 << 2,
+        isContinuous = 1 << 3,          // the playhead did not move since the previous block
+        isExtraTickInTimeSig8 = 1 << 4,
+        isForcedTick = 1 << 5,          // tick not on the grid, sent to stay above 30bpm (ppqPos is the block position)
+        isSubSampleTick = 1 << 6
+    };
+
+    struct Event {
+        double ppqPos;
+        double bpm;
+        int64_t timeInSamples;  // host position at the start of the block, -1 if not given
+        int64_t tickNo;
+        int32_t sampleOffset;
+        uint16_t type;
+        uint16_t flags;
+    };
+
+    static_assert(sizeof(Event) == 40, "the trace file format depends on the size of Event");
+
+    static constexpr uint32_t formatVersion = 1;
+
+    TelemetryRecorder();
+    ~TelemetryRecorder();
+
+    //==============================================================================
+    // audio thread only: a few loads and stores, and no-op when not recording
+    void push(const Event& event) noexcept
+    {
+        if (!recording.load(std::memory_order_relaxed))
+            return;
+
+        auto write = writeIndex.load(std::memory_order_relaxed);
+
+        if (write - readIndex.load(std::memory_order_acquire) >= capacity) { // full, the writer thread will report it
+            lostEvents.store(lostEvents.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return;
+        }
+
+        events[write & (capacity - 1)] = event;
+        writeIndex.store(write + 1, std::memory_order_release);
+    }
+
+    bool isRecording() const noexcept { return recording.load(std::memory_order_relaxed); }
+
+    //==============================================================================
+    // message thread: starts writing to traceFile (replaced if it exists), returns false if it cannot be opened
+    bool startRecording(const juce::File& traceFile);
+    void stopRecording();
+
+    juce::File getTraceFile() const { return currentTraceFile; }
+
+private:
+    //==============================================================================
+    class Writer;
+
+    void writeAvailableEvents(juce::OutputStream& out);
+
+    static constexpr uint32_t capacity = 4096; // power of 2, ~80ms of 1 sample blocks at 48kHz
+
+    juce::HeapBlock<Event> events;
+
+    // each index is only written by one thread, they are kept on separate cache lines
+    alignas(64) std::atomic<uint32_t> writeIndex { 0 };
+    alignas(64) std::atomic<uint32_t> readIndex { 0 };
+    alignas(64) std::atomic<uint32_t> lostEvents { 0 };
+    std::atomic<bool> recording { false };
+
+    uint32_t lostEventsReported = 0;
+
+    std::unique_ptr<Writer> writer;
+    juce::File currentTraceFile;
+
+    JUCE_DECLARE_NON_COPYABLE (TelemetryRecorder)
+};
@@ -0,0 +1,153 @@
+/*
+    ==============================================================================
+
+    This file is part of the Midronome plugin, a VST3/AU/AAX plugin for Digital
+    Audio Workstations (DAW) whose purpose is to synchronize DAWs with the
+    Midronome (more info on <https://www.midronome.com/>).
+
+    Copyright © 2023 - Simon Lasnier (Midronome ApS)
+
+    The Midronome plugin is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option) any
+    later version.
+
+    The Midronome plugin is distributed in the hope that it will be useful, but
+    WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+    details.
+
+    You should have received a copy of the GNU General Public License along with
+    the Midronome plugin. If not, see <https://www.gnu.org/licenses/>.
+
+    ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Timing statistics of the audio thread, shown by the editor's diagnostics view.
+
+    Each value is a relaxed atomic only written by the audio thread (plain loads
+    and stores, no read-modify-write), which the editor reads on its timer with
+    getSnapshot() - so neither side ever waits for the other. A snapshot is not
+    taken atomically as a whole, which is fine for display.
+
+    The CPU time of the blocks is only measured while a view shows it: reading
+    the clock twice per block is a good part of the cost of small blocks.
+*/
+class TimingDiagnostics
+{
+public:
+    // tick timing error (sent edge - exact tick position), in bins of 1/8 sample from 0 to 2 samples
+    // the last bin also counts the later ticks, and the ticks not on the grid (forced to stay above 30bpm)
+    static constexpr int numErrorBins = 17;
+    static constexpr double errorBinWidth = 0.125;
+
+    // host block sizes: <= 16, 32, 64... 4096, and > 4096 samples
+    static constexpr int numBlockSizeBins = 10;
+
+    struct Snapshot {
+        double sampleRate = 0.0;
+        uint64_t numTicks = 0;
+        uint64_t numSamplesPlaying = 0;
+        uint64_t numDiscontinuities = 0;
+        uint64_t errorBins[numErrorBins] = {};
+        uint64_t blockSizeBins[numBlockSizeBins] = {};
+        double lastBlockCpuSeconds = 0.0;
+        double maxBlockCpuSeconds = 0.0;
+        int lastBlockNumSamples = 0;
+    };
+
+    //==============================================================================
+    // audio thread
+    void reset(double sr) noexcept
+    {
+        sampleRate.store(sr, std::memory_order_relaxed);
+        numTicks.store(0, std::memory_order_relaxed);
+        numSamplesPlaying.store(0, std::memory_order_relaxed);
+        numDiscontinuities.store(0, std::memory_order_relaxed);
+        for (auto& bin : errorBins)
+            bin.store(0, std::memory_order_relaxed);
+        for (auto& bin : blockSizeBins)
+            bin.store(0, std::memory_order_relaxed);
+        maxBlockCpuSeconds.store(0.0, std::memory_order_relaxed);
+    }
+
+    void tickSent(double errorSamples, bool isOnGrid) noexcept
+    {
+        // compared before converting to int, as the error is infinite if the tick is sent before a tempo ramp reaches it
+        auto bin = numErrorBins - 1;
+        if (isOnGrid && errorSamples < (numErrorBins - 1) * errorBinWidth)
+            bin = errorSamples > 0.0 ? static_cast<int>(errorSamples / errorBinWidth) : 0;
+        increment(errorBins[bin]);
+        increment(numTicks);
+    }
+
+    void discontinuity() noexcept { increment(numDiscontinuities); }
+
+    // whether the CPU time of this block must be measured and given to cpuTimeMeasured()
+    bool isCpuTimeShown() const noexcept { return numViews.load(std::memory_order_relaxed) > 0; }
+
+    void blockProcessed(int numSamples, bool isPlaying) noexcept
+    {
+        auto bin = 0;
+        while (bin < numBlockSizeBins - 1 && numSamples > (16 << bin))
+            bin++;
+        increment(blockSizeBins[bin]);
+
+        if (isPlaying)
+            numSamplesPlaying.store(numSamplesPlaying.load(std::memory_order_relaxed) + static_cast<uint64_t>(numSamples), std::memory_order_relaxed);
+
+        lastBlockNumSamples.store(numSamples, std::memory_order_relaxed);
+    }
+
+    void cpuTimeMeasured(double cpuSeconds) noexcept
+    {
+        lastBlockCpuSeconds.store(cpuSeconds, std::memory_order_relaxed);
+        if (cpuSeconds > maxBlockCpuSeconds.load(std::memory_order_relaxed))
+            maxBlockCpuSeconds.store(cpuSeconds, std::memory_order_relaxed);
+    }
+
+    //==============================================================================
+    // message thread: a view showing the diagnostics is opened or closed
+    void viewOpened() noexcept { numViews.fetch_add(1, std::memory_order_relaxed); }
+    void viewClosed() noexcept { numViews.fetch_sub(1, std::memory_order_relaxed); }
+
+    // any thread
+    Snapshot getSnapshot() const noexcept
+    {
+        Snapshot s;
+        s.sampleRate = sampleRate.load(std::memory_order_relaxed);
+        s.numTicks = numTicks.load(std::memory_order_relaxed);
+        s.numSamplesPlaying = numSamplesPlaying.load(std::memory_order_relaxed);
+        s.numDiscontinuities = numDiscontinuities.load(std::memory_order_relaxed);
+        for (auto i = 0; i < numErrorBins; i++)
+            s.errorBins[i] = errorBins[i].load(std::memory_order_relaxed);
+        for (auto i = 0; i < numBlockSizeBins; i++)
+            s.blockSizeBins[i] = blockSizeBins[i].load(std::memory_order_relaxed);
+        s.lastBlockCpuSeconds = lastBlockCpuSeconds.load(std::memory_order_relaxed);
+        s.maxBlockCpuSeconds = maxBlockCpuSeconds.load(std::memory_order_relaxed);
+        s.lastBlockNumSamples = lastBlockNumSamples.load(std::memory_order_relaxed);
+        return s;
+    }
+
+private:
+    static void increment(std::atomic<uint64_t>& counter) noexcept {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    std::atomic<double> sampleRate { 0.0 };
+    std::atomic<uint64_t> numTicks { 0 };
+    std::atomic<uint64_t> numSamplesPlaying { 0 };
+    std::atomic<uint64_t> numDiscontinuities { 0 };
+    std::atomic<uint64_t> errorBins[numErrorBins] {};
+    std::atomic<uint64_t> blockSizeBins[numBlockSizeBins] {};
+    std::atomic<double> lastBlockCpuSeconds { 0.0 };
+    std::atomic<double> maxBlockCpuSeconds { 0.0 };
+    std::atomic<int> lastBlockNumSamples { 0 };
+    std::atomic<int> numViews { 0 };
+};